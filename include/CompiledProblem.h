@@ -0,0 +1,256 @@
+#ifndef MDPLIB_COMPILEDPROBLEM_H
+#define MDPLIB_COMPILEDPROBLEM_H
+
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Action.h"
+#include "MDPLib.h"
+#include "Problem.h"
+#include "State.h"
+
+namespace mlcore
+{
+
+/**
+ * A frozen snapshot of the transition model of a problem, stored in
+ * compressed-sparse-row (CSR) arrays.
+ *
+ * The snapshot contains all states in problem->states() (typically after a
+ * call to Problem::generateAll()), numbered 0, ..., numStates() - 1. States
+ * are numbered by their index in the problem (State::index()) whenever
+ * possible, so that they are found without a hash table lookup. For each
+ * state it stores the range of its applicable actions, and for each
+ * state-action pair it stores the cost and the range of its successors as
+ * (state number, probability) pairs. Algorithms that run on the snapshot
+ * never call the virtual transition, cost and applicable functions of the
+ * problem.
+ *
+ * Successors that are not in problem->states() (e.g., when the problem is a
+ * WrapperProblem with an overridden state set) are added to the snapshot as
+ * "fixed" states, which have no actions and whose value is not updated.
+ *
+ * Values are kept outside of the snapshot as vectors indexed by state number;
+ * initialValues() reads them from the state objects and commit() writes them
+ * back.
+ */
+class CompiledProblem
+{
+private:
+    /* The problem that was compiled. */
+    Problem* problem_;
+
+    /* Discount factor of the problem. */
+    double gamma_;
+
+    /* The state objects, indexed by state number. */
+    std::vector<State*> states_;
+
+    /*
+     * Maps state objects to state numbers, for the states whose number
+     * isn't their index (State::index()). The other states are found by
+     * their index, which is the case of all states unless problem->states()
+     * isn't the problem's own state table (e.g., a WrapperProblem with
+     * override states).
+     */
+    std::unordered_map<State*, uint32_t> others_;
+
+    /* The actions of the problem, in the order of problem->actions(). */
+    std::vector<Action*> actions_;
+
+    /* Per state: 1 if the state is a goal. */
+    std::vector<unsigned char> goal_;
+
+    /* Per state: 1 if the state is not in problem->states(). */
+    std::vector<unsigned char> fixed_;
+
+    /* Per state: first state-action pair (size numStates() + 1). */
+    std::vector<uint32_t> actionBegin_;
+
+    /* Per state-action pair: index of the action in actions_. */
+    std::vector<uint32_t> actionId_;
+
+    /* Per state-action pair: cost of the action. */
+    std::vector<double> cost_;
+
+    /* Per state-action pair: first successor (size numPairs() + 1). */
+    std::vector<uint32_t> successorBegin_;
+
+    /* Per successor: number of the successor state. */
+    std::vector<uint32_t> successorState_;
+
+    /* Per successor: probability of the successor. */
+    std::vector<double> successorProb_;
+
+    /* Adds a state to the snapshot. */
+    void append(State* s, unsigned char fixed);
+
+    /* Returns the number of the given state, adding it if necessary. */
+    uint32_t addState(State* s);
+
+public:
+    /**
+     * Compiles the transition model of the given problem restricted to the
+     * states in problem->states().
+     */
+    CompiledProblem(Problem* problem);
+
+    /**
+     * Returns the problem that was compiled.
+     */
+    Problem* problem() const { return problem_; }
+
+    /**
+     * Returns the number of states in the snapshot.
+     */
+    uint32_t numStates() const { return states_.size(); }
+
+    /**
+     * Returns the number of state-action pairs in the snapshot.
+     */
+    uint32_t numPairs() const { return actionId_.size(); }
+
+    /**
+     * Returns the state object with the given number.
+     */
+    State* state(uint32_t s) const { return states_[s]; }
+
+    /**
+     * Returns the number of the given state object,
+     * or mdplib::no_index if the state is not in the snapshot.
+     */
+    uint32_t number(State* s) const
+    {
+        uint32_t i = s->index();
+        if (i < states_.size() && states_[i] == s)
+            return i;
+        auto it = others_.find(s);
+        return it == others_.end() ? mdplib::no_index : it->second;
+    }
+
+    /**
+     * Returns the number of the initial state of the problem,
+     * or mdplib::no_index if it is not in the snapshot.
+     */
+    uint32_t initialState() const { return number(problem_->initialState()); }
+
+    bool goal(uint32_t s) const { return goal_[s]; }
+
+    bool fixed(uint32_t s) const { return fixed_[s]; }
+
+    /**
+     * First and one-past-last state-action pairs of state s.
+     */
+    uint32_t pairsBegin(uint32_t s) const { return actionBegin_[s]; }
+
+    uint32_t pairsEnd(uint32_t s) const { return actionBegin_[s + 1]; }
+
+    /**
+     * Returns the action of the given state-action pair.
+     */
+    Action* action(uint32_t sa) const { return actions_[actionId_[sa]]; }
+
+    /**
+     * Returns the cost of the given state-action pair.
+     */
+    double cost(uint32_t sa) const { return cost_[sa]; }
+
+    /**
+     * First and one-past-last successors of state-action pair sa.
+     */
+    uint32_t successorsBegin(uint32_t sa) const { return successorBegin_[sa]; }
+
+    uint32_t successorsEnd(uint32_t sa) const
+    {
+        return successorBegin_[sa + 1];
+    }
+
+    uint32_t successorState(uint32_t k) const { return successorState_[k]; }
+
+    double successorProb(uint32_t k) const { return successorProb_[k]; }
+
+    /**
+     * Returns the value of state s in the given values. The values can also
+     * be atomic, when other threads update them while they are read.
+     */
+    static double value(const std::vector<double>& values, uint32_t s)
+    {
+        return values[s];
+    }
+
+    static double value(const std::vector< std::atomic<double> >& values,
+                        uint32_t s)
+    {
+        return values[s].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Computes the Q-value of a state-action pair for the given values.
+     */
+    template<typename Values>
+    double qvalue(const Values& values, uint32_t sa) const
+    {
+        double q = 0.0;
+        for (uint32_t k = successorBegin_[sa]; k < successorBegin_[sa + 1]; k++)
+            q += successorProb_[k] * value(values, successorState_[k]);
+        return q * gamma_ + cost_[sa];
+    }
+
+    /**
+     * Performs a Bellman backup of state s for the given values, with the
+     * same semantics as mlsolvers::bellmanBackup().
+     *
+     * @param values The values of all states.
+     * @param s The state to back up.
+     * @param bestPair Stores the state-action pair with minimum Q-value,
+     *                 or mdplib::no_index if there is none.
+     * @return The backed up value.
+     */
+    template<typename Values>
+    double bellmanBackup(const Values& values,
+                         uint32_t s,
+                         uint32_t& bestPair) const
+    {
+        double bestQ = goal_[s] ? 0.0 : mdplib::dead_end_cost;
+        bestPair = mdplib::no_index;
+        for (uint32_t sa = actionBegin_[s]; sa < actionBegin_[s + 1]; sa++) {
+            double q = std::min(mdplib::dead_end_cost, qvalue(values, sa));
+            if (q <= bestQ) {
+                bestQ = q;
+                bestPair = sa;
+            }
+        }
+        return bestQ;
+    }
+
+    /**
+     * Returns the current values of all states (using State::cost()).
+     */
+    std::vector<double> initialValues() const;
+
+    /**
+     * Returns, for each state, the state-action pair of the state's current
+     * best action (State::bestAction()), or mdplib::no_index if the state has
+     * no best action.
+     */
+    std::vector<uint32_t> currentPolicy() const;
+
+    /**
+     * Writes the given values and policy back into the state objects.
+     * States without applicable actions are marked as dead-ends.
+     * Goal and fixed states are not modified.
+     *
+     * @param values The values of all states.
+     * @param policy The state-action pair chosen for each state
+     *               (mdplib::no_index for none). If empty, only the values
+     *               are written.
+     */
+    void commit(const std::vector<double>& values,
+                const std::vector<uint32_t>& policy) const;
+};
+
+}
+
+#endif // MDPLIB_COMPILEDPROBLEM_H
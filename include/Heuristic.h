@@ -1,6 +1,8 @@
 #ifndef MDPLIB_HEURISTIC_H
 #define MDPLIB_HEURISTIC_H
 
+#include <cstddef>
+
 #include "State.h"
 
 namespace mlcore
@@ -17,6 +19,19 @@ public:
      */
     virtual double cost(const State* s)=0;
 
+    /**
+     * Stores in costs[i] the estimate for states[i], for i = 0, ..., n - 1.
+     *
+     * Problem::computeHeuristics() evaluates states in batches with this
+     * method; heuristics that can share work among states (e.g., by running
+     * a single search for all of them) should override it.
+     */
+    virtual void costs(const State* const* states, size_t n, double* costs)
+    {
+        for (size_t i = 0; i < n; i++)
+            costs[i] = cost(states[i]);
+    }
+
     /**
      * Resets any internal state stored by the heuristic.
      */
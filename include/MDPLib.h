@@ -7,6 +7,9 @@ namespace mdplib
     extern double epsilon;
     extern double no_distance;
 
+    /* Index of states that have not been stored by a problem */
+    const unsigned int no_index = ~0u;
+
     /* Bitmasks for state bits */
     const unsigned long VISITED = 1ul;
     const unsigned long SOLVED = 1ul<<1;
@@ -1,16 +1,335 @@
 #ifndef MDPLIB_PROBLEM_H
 #define MDPLIB_PROBLEM_H
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cassert>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
 
 #include "State.h"
+#include "StateTable.h"
 #include "Action.h"
 #include "Heuristic.h"
+#include "SamplerCache.h"
+#include "ValueStore.h"
 
+#include "util/arena.h"
 #include "util/general.h"
+#include "util/hash.h"
+#include "util/parallel.h"
 
 namespace mlcore
 {
+/**
+ * The scratch objects of type T owned by the calling thread that are not
+ * currently leased. Used by SuccessorView and Expansion so that their
+ * storage is reused instead of being allocated on every call.
+ */
+template<typename T>
+class ScratchPool
+{
+private:
+    typedef std::vector< std::unique_ptr<T> > Objects;
+
+    static Objects& freeObjects()
+    {
+        static thread_local Objects objects;
+        return objects;
+    }
+
+public:
+    /**
+     * Leases an object of the calling thread (a new one if all are leased).
+     */
+    static T* acquire()
+    {
+        Objects& objects = freeObjects();
+        if (objects.empty())
+            return new T();
+        T* object = objects.back().release();
+        objects.pop_back();
+        return object;
+    }
+
+    /**
+     * Returns a leased object to the calling thread.
+     */
+    static void release(T* object)
+    {
+        freeObjects().emplace_back(object);
+    }
+};
+
+
+/**
+ * A read-only view over successors stored contiguously, as returned by
+ * Problem::successors().
+ *
+ * The successors are either owned by the problem (e.g., a successor cache
+ * kept in the state), or by a scratch buffer leased from the calling thread
+ * for the lifetime of the view (see scratch()). Scratch buffers are returned
+ * to the thread when the view is destroyed and are reused by later views, so
+ * iterating over a view doesn't allocate memory once the thread has warmed
+ * up. Views must be destroyed by the thread that created them.
+ */
+class SuccessorView
+{
+private:
+    /* The successors, if they are owned by someone else. */
+    const Successor* begin_;
+    const Successor* end_;
+
+    /* The scratch buffer leased by this view, if any. */
+    std::vector<Successor>* buffer_;
+
+    explicit SuccessorView(std::vector<Successor>* buffer)
+        : begin_(nullptr), end_(nullptr), buffer_(buffer) { }
+
+public:
+    /**
+     * Creates a view over the successors in [first, last), which are owned
+     * by the caller and must outlive the view.
+     */
+    SuccessorView(const Successor* first, const Successor* last)
+        : begin_(first), end_(last), buffer_(nullptr) { }
+
+    /**
+     * Creates a view over the successors stored in the given vector, which
+     * must outlive the view and not be modified while the view is used.
+     */
+    explicit SuccessorView(const std::vector<Successor>& successors)
+        : begin_(successors.data()),
+          end_(successors.data() + successors.size()),
+          buffer_(nullptr) { }
+
+    /**
+     * Returns an empty view that owns a scratch buffer of the calling
+     * thread. Successors are added to it with push_back().
+     */
+    static SuccessorView scratch()
+    {
+        std::vector<Successor>* buffer =
+            ScratchPool< std::vector<Successor> >::acquire();
+        buffer->clear();
+        return SuccessorView(buffer);
+    }
+
+    SuccessorView(SuccessorView&& other)
+        : begin_(other.begin_), end_(other.end_), buffer_(other.buffer_)
+    {
+        other.buffer_ = nullptr;
+    }
+
+    SuccessorView(const SuccessorView&) = delete;
+
+    SuccessorView& operator=(const SuccessorView&) = delete;
+
+    ~SuccessorView()
+    {
+        if (buffer_ != nullptr)
+            ScratchPool< std::vector<Successor> >::release(buffer_);
+    }
+
+    /**
+     * Adds a successor to a view created by scratch().
+     */
+    void push_back(const Successor& successor)
+    {
+        assert(buffer_ != nullptr);
+        buffer_->push_back(successor);
+    }
+
+    const Successor* begin() const
+    {
+        return buffer_ != nullptr ? buffer_->data() : begin_;
+    }
+
+    const Successor* end() const
+    {
+        return buffer_ != nullptr ? buffer_->data() + buffer_->size() : end_;
+    }
+
+    size_t size() const { return end() - begin(); }
+
+    bool empty() const { return size() == 0; }
+
+    const Successor& operator[](size_t i) const { return begin()[i]; }
+};
+
+
+/**
+ * The applicable actions of a state together with their costs and
+ * successors, as returned by Problem::expand().
+ *
+ * The storage is a scratch object leased from the calling thread for the
+ * lifetime of the expansion (see SuccessorView). Expansions must be
+ * destroyed by the thread that created them.
+ */
+class Expansion
+{
+private:
+    struct Storage {
+        std::vector<Action*> actions;
+        std::vector<double> costs;
+        /* The successors of actions[i] start at successors[first[i]]. */
+        std::vector<uint32_t> first;
+        std::vector<Successor> successors;
+    };
+
+    Storage* storage_;
+
+    explicit Expansion(Storage* storage) : storage_(storage) { }
+
+public:
+    /**
+     * Returns an empty expansion that owns a scratch storage of the calling
+     * thread. Actions are added with addAction(), and the successors of the
+     * last action added with push_back().
+     */
+    static Expansion scratch()
+    {
+        Storage* storage = ScratchPool<Storage>::acquire();
+        storage->actions.clear();
+        storage->costs.clear();
+        storage->first.clear();
+        storage->successors.clear();
+        return Expansion(storage);
+    }
+
+    Expansion(Expansion&& other) : storage_(other.storage_)
+    {
+        other.storage_ = nullptr;
+    }
+
+    Expansion(const Expansion&) = delete;
+
+    Expansion& operator=(const Expansion&) = delete;
+
+    ~Expansion()
+    {
+        if (storage_ != nullptr)
+            ScratchPool<Storage>::release(storage_);
+    }
+
+    /**
+     * Adds an applicable action with the given cost.
+     */
+    void addAction(Action* a, double cost)
+    {
+        storage_->actions.push_back(a);
+        storage_->costs.push_back(cost);
+        storage_->first.push_back(storage_->successors.size());
+    }
+
+    /**
+     * Adds a successor of the last action added.
+     */
+    void push_back(const Successor& successor)
+    {
+        assert(!storage_->actions.empty());
+        storage_->successors.push_back(successor);
+    }
+
+    /**
+     * Returns the number of applicable actions.
+     */
+    size_t size() const { return storage_->actions.size(); }
+
+    bool empty() const { return size() == 0; }
+
+    /**
+     * Returns the i-th applicable action.
+     */
+    Action* action(size_t i) const { return storage_->actions[i]; }
+
+    /**
+     * Returns the cost of the i-th applicable action.
+     */
+    double cost(size_t i) const { return storage_->costs[i]; }
+
+    /**
+     * Returns the successors of the i-th applicable action. The view is
+     * valid while the expansion is.
+     */
+    SuccessorView successors(size_t i) const
+    {
+        const Successor* base = storage_->successors.data();
+        size_t last = (i + 1 < size()) ?
+            storage_->first[i + 1] : storage_->successors.size();
+        return SuccessorView(base + storage_->first[i], base + last);
+    }
+};
+
+
+/**
+ * The progress of Problem::generateAll(const GenerateOptions&), reported
+ * after each level of the search.
+ */
+struct GenerateProgress {
+    /* The number of levels (distances from s0) expanded so far. */
+    int levels;
+
+    /* The number of states stored by the problem. */
+    size_t numStates;
+
+    /* The number of states expanded so far. */
+    size_t numExpanded;
+
+    /* The number of states reached but not expanded yet. */
+    size_t frontierSize;
+
+    /* The memory used by the stored states (see Problem::memoryUsage()). */
+    size_t memoryUsage;
+};
+
+
+/**
+ * The options of Problem::generateAll(const GenerateOptions&).
+ */
+struct GenerateOptions {
+    /* If true, the predecessor index is also built. */
+    bool storePredecessors;
+
+    /* The number of threads expanding states. */
+    int numThreads;
+
+    /*
+     * Generation stops once the problem stores this many states
+     * (0 means no limit).
+     */
+    size_t maxStates;
+
+    /*
+     * Generation stops once the stored states use this many bytes
+     * (see Problem::memoryUsage(); 0 means no limit).
+     */
+    size_t maxMemory;
+
+    /*
+     * If true, the heuristic costs of the states reached at each level are
+     * computed by the threads, in batches (see Problem::computeHeuristics()).
+     */
+    bool computeHeuristic;
+
+    /* If set, called by one of the threads after each level. */
+    std::function<void(const GenerateProgress&)> progress;
+
+    GenerateOptions() :
+        storePredecessors(false), numThreads(1), maxStates(0), maxMemory(0),
+        computeHeuristic(false)
+    { }
+};
+
+
 /**
  * An abstract class for Stochastic Shortest Path Problem objects.
  *
@@ -25,6 +344,10 @@ namespace mlcore
  * whenever a state is generated by the transition function. This ensures that
  * no duplicate states will be kept in memory. Moreover, the provided
  * destructor will take care of cleaning up all generated states.
+ *
+ * Every state stored by 'addState' receives a dense index (see
+ * State::index()), so that stored states are numbered 0, 1, ..., n - 1 in the
+ * order in which they were generated.
  */
 class Problem
 {
@@ -47,31 +370,305 @@ protected:
      * An internal structure to store all states that are generated by
      * calls to the transition function.
      */
-    StateSet states_;
+    StateTable states_;
+
+    /**
+     * If true, several threads may store states at the same time, and the
+     * shards of states_ and the arenas are locked (see concurrentStates()).
+     */
+    bool concurrentStates_;
+
+    /**
+     * Serializes the loads of new states into valueStore_ while
+     * concurrentStates_ is true.
+     */
+    std::mutex valueStoreMutex_;
+
+    /**
+     * If not null, the struct-of-arrays storage for the solver values of the
+     * stored states (see useValueStore()).
+     */
+    ValueStore* valueStore_;
+
+    /**
+     * Predecessor index built by generateAll(true): the dense indices of the
+     * predecessors of the state with dense index i are stored in
+     * predecessors_[predecessorBegin_[i]], ...,
+     * predecessors_[predecessorBegin_[i + 1] - 1].
+     */
+    std::vector<uint32_t> predecessorBegin_;
+    std::vector<uint32_t> predecessors_;
+
+    /**
+     * For each entry of predecessors_, the largest probability with which
+     * the predecessor transitions into the state with a single action.
+     */
+    std::vector<double> predecessorProbs_;
 
     /**
      * A heuristic that estimates the cost to reach a goal from any state.
      */
     Heuristic* heuristic_;
 
+    /**
+     * The memory of the states created by newState() and of the successor
+     * runs created by newSuccessors(), released in bulk when the problem is
+     * destroyed (or reused after clearStates()).
+     */
+    SlabArena<> stateArena_;
+    OffsetArena<Successor> successorArena_;
+
+    /**
+     * Serializes allocations from the arenas while concurrentStates_ is
+     * true.
+     */
+    std::mutex arenaMutex_;
+
+    /**
+     * If true, sampleSuccessor() caches an alias table for each (state,
+     * action) pair it samples. Domains whose transition function never
+     * changes enable it in their constructors (see cacheSamplers()).
+     */
+    bool cacheSamplers_;
+
+    /* The number of shards of the alias tables (a power of 2). */
+    static const size_t numSamplerShards = 16;
+
+    /**
+     * The alias tables built by sampleSuccessor(), split in shards by
+     * (state, action) so that concurrent threads rarely wait for each other.
+     */
+    SamplerCache samplers_[numSamplerShards];
+
+    /**
+     * Serializes access to each shard of samplers_ while concurrentStates_
+     * is true. The tables themselves are never modified after they are
+     * inserted, so they are read without holding the lock.
+     */
+    std::mutex samplersMutex_[numSamplerShards];
+
+    /* Returns the shard of samplers_ holding the table of (s, a). */
+    static size_t samplerShard(State* s, Action* a)
+    {
+        // The high bits, since the shards' hash tables use the low ones.
+        return mdplib::mix64(reinterpret_cast<uintptr_t>(s) ^
+                             reinterpret_cast<uintptr_t>(a) << 1) >>
+            (64 - 4);
+    }
+
+private:
+
+    typedef std::vector< std::vector< std::pair<uint32_t, double> > >
+        PredecessorLists;
+
+    /*
+     * Records pred as a predecessor of s with the given transition
+     * probability, keeping the largest probability for repeated edges.
+     */
+    static void addPredecessor(PredecessorLists& lists,
+                               const State* s,
+                               const State* pred,
+                               double prob)
+    {
+        uint32_t i = s->index(), j = pred->index();
+        if (i == mdplib::no_index || j == mdplib::no_index)
+            return;
+        if (i >= lists.size())
+            lists.resize(i + 1);
+        // All edges of pred are added before those of any other state, so a
+        // repeated edge can only be the last one added.
+        if (!lists[i].empty() && lists[i].back().first == j)
+            lists[i].back().second = std::max(lists[i].back().second, prob);
+        else
+            lists[i].push_back(std::make_pair(j, prob));
+    }
+
+    /*
+     * Replaces the predecessor index with the edges in the given lists.
+     * The predecessors of each state are those in lists[0], lists[1], ...
+     */
+    void buildPredecessorIndex(std::vector<PredecessorLists>& lists)
+    {
+        for (PredecessorLists& predecessors : lists)
+            predecessors.resize(states_.size());
+        predecessorBegin_.assign(1, 0);
+        predecessors_.clear();
+        predecessorProbs_.clear();
+        for (size_t i = 0; i < states_.size(); i++) {
+            for (PredecessorLists& predecessors : lists) {
+                for (auto const & edge : predecessors[i]) {
+                    predecessors_.push_back(edge.first);
+                    predecessorProbs_.push_back(edge.second);
+                }
+            }
+            predecessorBegin_.push_back(predecessors_.size());
+        }
+    }
+
+    /*
+     * Returns true if the stored states exceed the given number of states
+     * or bytes (0 means no limit). Safe to call while other threads store
+     * states.
+     */
+    bool overBudget(size_t maxStates, size_t maxMemory)
+    {
+        if (maxStates == 0 && maxMemory == 0)
+            return false;
+        if (maxStates > 0 && states_.size() >= maxStates)
+            return true;
+        std::lock_guard<std::mutex> arenaLock(arenaMutex_);
+        return maxMemory > 0 && memoryUsage() >= maxMemory;
+    }
+
+    /*
+     * Stores s unless an equal state is already stored, in which case s is
+     * deleted. Returns the stored state. A new state gets its position in
+     * states_ as its dense index before other threads can find it.
+     */
+    State* storeState(State* s)
+    {
+        auto it = states_.insert(s, [this] (State* state, uint32_t index) {
+            state->index_ = index;
+            if (valueStore_ != nullptr) {
+                std::unique_lock<std::mutex> lock(valueStoreMutex_,
+                                                  std::defer_lock);
+                if (concurrentStates_)
+                    lock.lock();
+                valueStore_->load(state);
+            }
+        });
+        State* ret = it.first;
+        if (!it.second && ret != s) {
+            // The state was found but the object representing it in
+            // memory is different to the given one, delete the given one.
+            destroyState(s);
+        }
+        return ret;
+    }
+
 public:
 
     /**
      * Common constructor for initializing gamma and the heuristic.
      */
-    Problem() : gamma_(1.0), heuristic_(nullptr) {}
+    Problem() : gamma_(1.0),
+                concurrentStates_(false),
+                valueStore_(nullptr),
+                heuristic_(nullptr),
+                cacheSamplers_(false) {}
 
     /**
      * Common destructor. Destroys all stored states and all actions.
      */
     virtual ~Problem()
     {
+        delete valueStore_;
         for (State* state : states_)
-            delete (state);
+            destroyState(state);
         for (Action* action : actions_)
             delete (action);
     }
 
+    /**
+     * Creates a state of type T (constructed with the given arguments) in
+     * the state arena of this problem. Its memory is released in bulk with
+     * the problem, which avoids one heap allocation per state and makes
+     * destroying large problems much faster.
+     *
+     * The state must be stored with addState() or destroyed with
+     * destroyState(), never with delete.
+     */
+    template<typename T, typename... Args>
+    T* newState(Args&&... args)
+    {
+        std::unique_lock<std::mutex> lock(arenaMutex_, std::defer_lock);
+        if (concurrentStates_)
+            lock.lock();
+        void* memory = stateArena_.allocate(sizeof(T), alignof(T));
+        T* state = new (memory) T(std::forward<Args>(args)...);
+        state->inArena_ = true;
+        return state;
+    }
+
+    /**
+     * Destroys a state created with new or with newState(). The memory of
+     * states in the arena is only reclaimed when the arena is released.
+     */
+    static void destroyState(State* s)
+    {
+        if (s->inArena_)
+            s->~State();
+        else
+            delete s;
+    }
+
+    /**
+     * Returns n consecutive successors allocated from the successor arena
+     * of this problem, valid until the problem is destroyed (or until
+     * clearStates() is called). Domains can use them to cache successors
+     * without a heap allocation per state. At most 16384 successors (see
+     * OffsetArena::maxRun()) can be allocated at once, and the program is
+     * aborted if more are requested.
+     *
+     * If offset is not null, it receives the offset of the successors in
+     * the arena, which is smaller than a pointer to store and can be turned
+     * back into one with successorsAt().
+     */
+    Successor* newSuccessors(size_t n, uint32_t* offset = nullptr)
+    {
+        if (n > OffsetArena<Successor>::maxRun()) {
+            std::cerr << "Problem::newSuccessors: " << n << " successors "
+                      << "requested, at most "
+                      << OffsetArena<Successor>::maxRun() << " allowed"
+                      << std::endl;
+            abort();
+        }
+        std::unique_lock<std::mutex> lock(arenaMutex_, std::defer_lock);
+        if (concurrentStates_)
+            lock.lock();
+        uint32_t runOffset = successorArena_.allocate(n);
+        if (offset != nullptr)
+            *offset = runOffset;
+        return successorArena_.at(runOffset);
+    }
+
+    /**
+     * Returns the successors allocated by newSuccessors() at the given
+     * offset. Safe to call while other threads allocate successors.
+     */
+    const Successor* successorsAt(uint32_t offset) const
+    {
+        return successorArena_.at(offset);
+    }
+
+    /**
+     * Destroys all stored states (including the initial state) and makes
+     * the memory of the arenas available for the next states, so that a
+     * problem can be reused between episodes without returning the memory
+     * to the allocator. The subclass is responsible for creating and
+     * storing a new initial state.
+     *
+     * This method is not thread-safe.
+     */
+    void clearStates()
+    {
+        for (State* state : states_)
+            destroyState(state);
+        states_.clear();
+        predecessorBegin_.clear();
+        predecessors_.clear();
+        predecessorProbs_.clear();
+        if (valueStore_ != nullptr) {
+            delete valueStore_;
+            valueStore_ = new ValueStore(this);
+        }
+        stateArena_.clear();
+        successorArena_.clear();
+        for (SamplerCache& samplers : samplers_)
+            samplers.clear();
+        s0 = nullptr;
+    }
+
     /**
      * Goal check.
      *
@@ -92,6 +689,140 @@ public:
      */
     virtual std::list<Successor> transition(State* s, Action *a) =0;
 
+    /**
+     * Returns the successors of the given state when the given action is
+     * applied, in the same order as transition(), as a view over contiguous
+     * storage. Unlike transition(), this doesn't allocate a list node per
+     * successor, so solvers should prefer it in their inner loops.
+     *
+     * The default implementation copies the list returned by transition()
+     * into a scratch buffer. Domains can override it to return their own
+     * storage (e.g., a successor cache) or to fill a scratch buffer directly
+     * (see SuccessorView::scratch()).
+     *
+     * @return A view over the successors of the given state after applying
+     *         the given action.
+     */
+    virtual SuccessorView successors(State* s, Action *a)
+    {
+        SuccessorView view = SuccessorView::scratch();
+        for (const Successor& su : transition(s, a))
+            view.push_back(su);
+        return view;
+    }
+
+    /**
+     * Samples a successor of the given state when the given action is
+     * applied, using a number drawn uniformly from [0, 1].
+     *
+     * If cacheSamplers() is enabled, the successors of each (state, action)
+     * pair are stored in an alias table the first time the pair is sampled,
+     * and later samples take constant time without calling successors().
+     * Otherwise the successors are walked, accumulating probabilities.
+     * Either way, if the probabilities add up to less than 1, the state
+     * itself is returned for the remaining probability (with *prob = 1).
+     *
+     * @param s The state for which the successor will be sampled.
+     * @param a The action that generates the successors.
+     * @param pick A number drawn uniformly from [0, 1].
+     * @param prob If not null, it receives the probability of the returned
+     *             successor.
+     * @return The sampled successor.
+     */
+    State* sampleSuccessor(State* s, Action* a, double pick,
+                           double* prob = nullptr)
+    {
+        if (!cacheSamplers_) {
+            double acc = 0.0;
+            for (const Successor& sccr : successors(s, a)) {
+                acc += sccr.su_prob;
+                if (acc >= pick) {
+                    if (prob != nullptr)
+                        *prob = sccr.su_prob;
+                    return sccr.su_state;
+                }
+            }
+            if (prob != nullptr)
+                *prob = 1.0;
+            return s;
+        }
+        size_t shard = samplerShard(s, a);
+        std::unique_lock<std::mutex> lock(samplersMutex_[shard],
+                                          std::defer_lock);
+        if (concurrentStates_)
+            lock.lock();
+        const SamplerCache::Table* table = samplers_[shard].find(s, a);
+        if (table == nullptr) {
+            // The successors are computed without holding the lock.
+            if (concurrentStates_)
+                lock.unlock();
+            SuccessorView view = successors(s, a);
+            if (concurrentStates_)
+                lock.lock();
+            table = samplers_[shard].insert(s, a, view.begin(), view.end());
+        }
+        // Tables are immutable and never move once inserted.
+        if (concurrentStates_)
+            lock.unlock();
+        const SamplerCache::Entry& entry =
+            SamplerCache::sample(*table, std::min(pick, 1.0 - 1.0e-12));
+        if (prob != nullptr)
+            *prob = entry.prob;
+        return entry.state;
+    }
+
+    /**
+     * Enables or disables the alias tables of sampleSuccessor(). Domains
+     * must disable them (or call clearSamplers()) when their transition
+     * function changes.
+     */
+    void cacheSamplers(bool value)
+    {
+        cacheSamplers_ = value;
+        if (!value)
+            clearSamplers();
+    }
+
+    /**
+     * Returns true if sampleSuccessor() caches alias tables.
+     */
+    bool cacheSamplers() const
+    {
+        return cacheSamplers_;
+    }
+
+    /**
+     * Removes the alias tables built by sampleSuccessor(), e.g., after the
+     * transition function of the problem changes. Not thread-safe.
+     */
+    void clearSamplers()
+    {
+        for (SamplerCache& samplers : samplers_)
+            samplers.clear();
+    }
+
+    /**
+     * Returns all actions applicable to the given state, in the order of
+     * actions(), together with their costs and successors.
+     *
+     * The default implementation tests every action with applicable() and
+     * calls cost() and successors() for the applicable ones. Domains with
+     * many actions but few applicable ones in each state can override it to
+     * enumerate only the applicable actions.
+     */
+    virtual Expansion expand(State* s)
+    {
+        Expansion expansion = Expansion::scratch();
+        for (Action* a : actions_) {
+            if (!applicable(s, a))
+                continue;
+            expansion.addAction(a, cost(s, a));
+            for (const Successor& su : successors(s, a))
+                expansion.push_back(su);
+        }
+        return expansion;
+    }
+
     /**
      * Cost function for the problem.
      *
@@ -123,31 +854,197 @@ public:
     /**
     * Generates all states that can be reached from s0 and stores them.
     *
-    * WARNING: This method changes the value of the 'bits' variable for all
-    * states in the state set. Do not call this method while other code is using
-    * these values.
+    * The states are marked with a new visit epoch (see
+    * State::newVisitEpoch()), so the cost of the search doesn't depend on
+    * the number of states stored before.
+    *
+    * @param storePredecessors If true, the predecessor index is also built
+    *                          (see predecessors()), replacing any index
+    *                          built before.
     */
-    void generateAll()
+    void generateAll(bool storePredecessors = false)
     {
-        for (State* state: states_)
-            state->clearBits(mdplib::VISITED);
+        uint32_t epoch = State::newVisitEpoch();
+        std::vector<PredecessorLists> predecessors(1);
         std::list<State *> queue;
         queue.push_front(s0);
         while (!queue.empty()) {
             State* cur = queue.front();
             queue.pop_front();
-            if (cur->checkBits(mdplib::VISITED))
+            if (!cur->markVisited(epoch))
                 continue;
-            cur->setBits(mdplib::VISITED);
             for (Action* a : actions_) {
                 if (!applicable(cur, a))
                     continue;
-                std::list<Successor> successors = transition(cur, a);
-                for (Successor sccr : successors) {
+                for (const Successor& sccr : successors(cur, a)) {
                     queue.push_front(sccr.su_state);
+                    if (storePredecessors)
+                        addPredecessor(predecessors[0], sccr.su_state, cur,
+                                       sccr.su_prob);
                 }
             }
         }
+        if (storePredecessors)
+            buildPredecessorIndex(predecessors);
+    }
+
+    /**
+     * Generates the states that can be reached from s0 with several threads,
+     * level by level: the states at distance d from s0 are split among the
+     * threads, and the new states they reach form level d + 1. States are
+     * interned with addState() while concurrentStates() is enabled, so the
+     * transition function must be safe to call from several threads (as
+     * for LRTDPSolver::numThreads()), as long as no two threads expand the
+     * same state. The dense indices of the states depend on the order in
+     * which the threads store them.
+     *
+     * Generation stops gracefully, leaving the states stored so far, soon
+     * after the problem stores options.maxStates states or the stored
+     * states use options.maxMemory bytes. In that case no predecessor index
+     * is built, and any index built before is discarded.
+     *
+     * Like generateAll(bool), the states are marked with a new visit epoch.
+     * If options.computeHeuristic is true, the heuristic must also be safe
+     * to call from several threads.
+     *
+     * @param options The number of threads, the budgets, and a function
+     *                called with the progress after each level.
+     * @return true if all reachable states were generated, false if a
+     *         budget stopped the generation.
+     */
+    bool generateAll(const GenerateOptions& options)
+    {
+        uint32_t epoch = State::newVisitEpoch();
+        int numThreads = std::max(1, options.numThreads);
+        std::vector<PredecessorLists> predecessors(
+            options.storePredecessors ? numThreads : 0);
+        std::vector< std::vector<State*> > reached(numThreads);
+        std::vector<State*> frontier(1, s0);
+        s0->markVisited(epoch);
+        if (options.computeHeuristic)
+            computeHeuristics(frontier.data(), frontier.size());
+        // The next state of the level to expand, and whether a budget was
+        // exceeded.
+        std::atomic<size_t> next(0);
+        std::atomic<bool> stop(false);
+        GenerateProgress progress = {0, 0, 0, 1, 0};
+        bool complete = true;
+        Barrier barrier(numThreads);
+        bool concurrentStates = concurrentStates_;
+        this->concurrentStates(concurrentStates || numThreads > 1);
+        runThreads(numThreads, [&] (int t) {
+            size_t expanded = 0;
+            while (!frontier.empty()) {
+                while (!stop.load(std::memory_order_relaxed)) {
+                    size_t i = next.fetch_add(1);
+                    if (i >= frontier.size())
+                        break;
+                    State* cur = frontier[i];
+                    for (Action* a : actions_) {
+                        if (!applicable(cur, a))
+                            continue;
+                        for (const Successor& sccr : successors(cur, a)) {
+                            State* sccrState = sccr.su_state;
+                            if (sccrState->markVisitedAtomic(epoch))
+                                reached[t].push_back(sccrState);
+                            if (options.storePredecessors)
+                                addPredecessor(predecessors[t], sccrState,
+                                               cur, sccr.su_prob);
+                        }
+                    }
+                    if (++expanded % 64 == 0 &&
+                            overBudget(options.maxStates, options.maxMemory))
+                        stop = true;
+                }
+                if (options.computeHeuristic)
+                    computeHeuristics(reached[t].data(), reached[t].size());
+                // The last thread to finish the level sets up the next one.
+                barrier.wait([&] {
+                    size_t done = std::min(next.load(), frontier.size());
+                    size_t unexpanded = frontier.size() - done;
+                    frontier.clear();
+                    for (std::vector<State*>& states : reached) {
+                        frontier.insert(frontier.end(),
+                                        states.begin(), states.end());
+                        states.clear();
+                    }
+                    next = 0;
+                    progress.levels++;
+                    progress.numExpanded += done;
+                    progress.numStates = states_.size();
+                    progress.frontierSize = frontier.size() + unexpanded;
+                    progress.memoryUsage = memoryUsage();
+                    if (stop ||
+                            overBudget(options.maxStates, options.maxMemory)) {
+                        complete = false;
+                        frontier.clear();
+                    }
+                    if (options.progress)
+                        options.progress(progress);
+                });
+            }
+        });
+        this->concurrentStates(concurrentStates);
+        if (complete && options.storePredecessors) {
+            buildPredecessorIndex(predecessors);
+        } else if (!complete) {
+            predecessorBegin_.clear();
+            predecessors_.clear();
+            predecessorProbs_.clear();
+        }
+        return complete;
+    }
+
+    /**
+     * Returns an estimate of the memory used by the stored states, in bytes:
+     * the state table (including the dense index of the states), and the
+     * state and successor arenas
+     * (see newState()). States allocated outside the arena are not included.
+     *
+     * This method is not thread-safe.
+     */
+    size_t memoryUsage() const
+    {
+        return states_.memoryUsage()
+            + stateArena_.capacity()
+            + successorArena_.capacity() * sizeof(Successor);
+    }
+
+    /**
+     * Returns true if the predecessor index has been built
+     * (see generateAll()).
+     */
+    bool hasPredecessors() const
+    {
+        return !predecessorBegin_.empty();
+    }
+
+    /**
+     * Returns the dense indices of the states from which the given state can
+     * be reached with a single action, as a [first, last) range. The range
+     * is empty for states that were not generated by the last call to
+     * generateAll(true).
+     *
+     * The largest probability of reaching the state from the predecessor at
+     * position k of the range is predecessorProbs(s)[k].
+     */
+    std::pair<const uint32_t*, const uint32_t*>
+    predecessors(const State* s) const
+    {
+        uint32_t i = s->index();
+        if (i + 1 >= predecessorBegin_.size())
+            return std::make_pair(nullptr, nullptr);
+        const uint32_t* base = predecessors_.data();
+        return std::make_pair(base + predecessorBegin_[i],
+                              base + predecessorBegin_[i + 1]);
+    }
+
+    const double* predecessorProbs(const State* s) const
+    {
+        uint32_t i = s->index();
+        if (i + 1 >= predecessorBegin_.size())
+            return nullptr;
+        return predecessorProbs_.data() + predecessorBegin_[i];
     }
 
     /**
@@ -155,22 +1052,112 @@ public:
      * it returns the expanded state. Otherwise, it stores the state first
      * and the returns it.
      *
-     * This method relies on the equals() and hashValue() methods of the
-     * State class.
+     * This method relies on the packKey() method of the State class, or
+     * on its equals() and hash64() methods if the state has no key.
      *
      * @param s A state used as a model of an internal state to be returned.
      * @return The state stored internally that equals the given state.
      */
     State* addState(State* s)
     {
-        bool check = states_.insert(s).second;
-        State* ret = *states_.find(s);
-        // If the the state was found but the object representing it in
-        // memory is different to the given one, delete the given one.
-        if ((void *) ret != (void *) s && !check) {
-            delete s;
+        return storeState(s);
+    }
+
+    /**
+     * Returns the stored state with the given packed key (see
+     * State::packKey()). If there is no such state, it calls make(), which
+     * must return a new state with that key, and stores the new state.
+     *
+     * Unlike addState(State*), no state object is created if the state has
+     * already been stored, which is the common case once a search has
+     * visited most of the reachable states.
+     *
+     * @param key The packed key of the state.
+     * @param keySize The number of words of the key.
+     * @param make A function with no arguments returning a new State*.
+     * @return The state stored internally with the given key.
+     */
+    template<typename MakeState>
+    State* addState(const uint64_t* key, unsigned keySize, MakeState make)
+    {
+        State* ret = states_.get(key, keySize);
+        if (ret != nullptr)
+            return ret;
+        return storeState(make());
+    }
+
+    /**
+     * Returns the stored state with the given dense index.
+     *
+     * @param index A dense index in [0, numStates()).
+     * @return The state stored with the given index.
+     */
+    State* stateAt(uint32_t index) const
+    {
+        return states_.state(index);
+    }
+
+    /**
+     * Returns the number of states stored so far.
+     */
+    uint32_t numStates() const
+    {
+        return states_.size();
+    }
+
+    /**
+     * Enables or disables the struct-of-arrays value store.
+     *
+     * When enabled, the values of all stored states (and of any state
+     * stored later) are copied into a ValueStore indexed by the states'
+     * dense indices, and solvers that support it (bellmanUpdate, VISolver)
+     * read and write the values there. Disabling the store writes the
+     * values back into the state objects.
+     */
+    void useValueStore(bool value)
+    {
+        if (value && valueStore_ == nullptr) {
+            valueStore_ = new ValueStore(this);
+            for (State* s : states_)
+                valueStore_->load(s);
+        } else if (!value && valueStore_ != nullptr) {
+            syncValueStore();
+            delete valueStore_;
+            valueStore_ = nullptr;
         }
-        return ret;
+    }
+
+    /**
+     * Returns the value store of this problem, or nullptr if the problem
+     * is not using one.
+     */
+    ValueStore* valueStore()
+    {
+        return valueStore_;
+    }
+
+    /**
+     * Writes the values held by the value store (if any) back into the
+     * state objects.
+     */
+    void syncValueStore()
+    {
+        if (valueStore_ == nullptr)
+            return;
+        for (State* s : states_)
+            valueStore_->store(s);
+    }
+
+    /**
+     * Copies the values of the state objects into the value store (if any),
+     * for solvers that update the state objects directly.
+     */
+    void reloadValueStore()
+    {
+        if (valueStore_ == nullptr)
+            return;
+        for (State* s : states_)
+            valueStore_->load(s);
     }
 
     /**
@@ -179,18 +1166,52 @@ public:
      */
     State* getState(State* s)
     {
-        if (states_.count(s) > 0)
-            return *states_.find(s);
-        return nullptr;
+        return states_.get(s);
     }
 
+    /**
+     * Returns the stored state with the given packed key (see
+     * State::packKey()), or nullptr if there is no such state.
+     */
+    State* getState(const uint64_t* key, unsigned keySize)
+    {
+        return states_.get(key, keySize);
+    }
 
     /**
-     * Returns the set containing all states generated so far.
+     * Enables or disables concurrent calls to addState() and getState().
+     *
+     * Transition functions call addState() for every successor they
+     * generate, so this must be enabled while several threads call
+     * transition() on this problem (e.g., LRTDPSolver with more than one
+     * thread). The state table is then locked per shard (see StateTable),
+     * so threads storing different states rarely wait for each other.
+     * Other accessors of the stored states (states(), stateAt()) are not
+     * protected; numStates() can be called at any time.
+     */
+    void concurrentStates(bool value)
+    {
+        concurrentStates_ = value;
+        states_.concurrent(value);
+    }
+
+    /**
+     * Returns true if addState() and getState() can be called concurrently
+     * (see concurrentStates(bool)).
+     */
+    bool concurrentStates() const
+    {
+        return concurrentStates_;
+    }
+
+
+    /**
+     * Returns the set containing all states generated so far. Iterating over
+     * it visits the states in the order in which they were stored.
      *
      * @return The states generated so far.
      */
-    virtual StateSet& states()
+    virtual StateTable& states()
     {
         return states_;
     }
@@ -226,10 +1247,45 @@ public:
 
     /**
      Sets the heuristic to use for this problem.
+
+     The heuristic costs cached by the stored states are cleared.
      */
     void setHeuristic(Heuristic* heuristic)
     {
         heuristic_ = heuristic;
+        clearHeuristicCosts();
+    }
+
+    /**
+     * Computes the heuristic costs of the given states that haven't cached
+     * one yet (see State::heuristicCost()), with a single call to
+     * Heuristic::costs().
+     */
+    void computeHeuristics(State* const* states, size_t n)
+    {
+        if (heuristic_ == nullptr)
+            return;
+        std::vector<State*> pending;
+        for (size_t i = 0; i < n; i++) {
+            if (!states[i]->hasHeuristicCost())
+                pending.push_back(states[i]);
+        }
+        if (pending.empty())
+            return;
+        std::vector<double> costs(pending.size());
+        heuristic_->costs(pending.data(), pending.size(), costs.data());
+        for (size_t i = 0; i < pending.size(); i++)
+            pending[i]->heuristicCost(costs[i]);
+    }
+
+    /**
+     * Clears the heuristic costs cached by the stored states. Must be called
+     * if the heuristic starts returning different values for them.
+     */
+    void clearHeuristicCosts()
+    {
+        for (State* s : states_)
+            s->clearHeuristicCost();
     }
 };
 
@@ -0,0 +1,157 @@
+#ifndef MDPLIB_SAMPLERCACHE_H
+#define MDPLIB_SAMPLERCACHE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Action.h"
+#include "State.h"
+
+#include "util/alias.h"
+#include "util/arena.h"
+#include "util/hash.h"
+
+namespace mlcore
+{
+
+/**
+ * A cache of alias tables for sampling the successors of (state, action)
+ * pairs in constant time (see Problem::sampleSuccessor()).
+ *
+ * Each table stores the successor states together with their probabilities,
+ * so sampling from a cached table doesn't call the transition function. The
+ * tables are only valid as long as the transition function doesn't change,
+ * and the cache must be cleared otherwise.
+ *
+ * The cache itself is not thread-safe.
+ */
+class SamplerCache
+{
+public:
+    /* An outcome of a table. */
+    struct Entry {
+        /* The successor state. */
+        State* state;
+
+        /* The probability reported for the successor. */
+        double prob;
+    };
+
+    /*
+     * The outcomes of a (state, action) pair and their alias table, in size
+     * consecutive entries each.
+     */
+    struct Table {
+        const Entry* entries;
+        const mdplib::AliasEntry* aliases;
+        uint32_t size;
+    };
+
+private:
+    typedef std::pair<State*, Action*> Key;
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return mdplib::mix64(reinterpret_cast<uintptr_t>(key.first) ^
+                                 reinterpret_cast<uintptr_t>(key.second) << 1);
+        }
+    };
+
+    /* The tables, by (state, action). */
+    std::unordered_map<Key, Table, KeyHash> tables_;
+
+    /* The entries of all tables. */
+    BlockArena<Entry> entries_;
+    BlockArena<mdplib::AliasEntry> aliases_;
+
+    /* Buffer for the weights of the table being built. */
+    std::vector<double> weights_;
+
+public:
+    SamplerCache() { }
+
+    SamplerCache(const SamplerCache&) = delete;
+
+    SamplerCache& operator=(const SamplerCache&) = delete;
+
+    /**
+     * Returns the table for the given state and action, or nullptr if it
+     * hasn't been built.
+     */
+    const Table* find(State* s, Action* a) const
+    {
+        auto it = tables_.find(Key(s, a));
+        return it == tables_.end() ? nullptr : &it->second;
+    }
+
+    /**
+     * Builds and stores the table for the given state and action, whose
+     * successors are in [first, last), and returns it. If the probabilities
+     * add up to less than 1, the remaining probability is assigned to s
+     * (reported with probability 1), as done by the transition walk in
+     * Problem::sampleSuccessor().
+     *
+     * If a table for the state and action was already stored, it is
+     * returned instead.
+     */
+    const Table* insert(State* s, Action* a,
+                        const Successor* first, const Successor* last)
+    {
+        auto it = tables_.find(Key(s, a));
+        if (it != tables_.end())
+            return &it->second;
+        weights_.clear();
+        double total = 0.0;
+        for (const Successor* su = first; su != last; su++) {
+            weights_.push_back(su->su_prob);
+            total += su->su_prob;
+        }
+        bool stay = total < 1.0 - 1.0e-9 || first == last;
+        if (stay)
+            weights_.push_back(std::max(0.0, 1.0 - total));
+        uint32_t size = weights_.size();
+        mdplib::AliasEntry* aliases = aliases_.allocate(size);
+        mdplib::buildAliasTable(weights_.data(), size, aliases);
+        Entry* entries = entries_.allocate(size);
+        uint32_t i = 0;
+        for (const Successor* su = first; su != last; su++, i++) {
+            entries[i].state = su->su_state;
+            entries[i].prob = su->su_prob;
+        }
+        if (stay) {
+            entries[i].state = s;
+            entries[i].prob = 1.0;
+        }
+        Table table = {entries, aliases, size};
+        return &tables_.insert(std::make_pair(Key(s, a), table)).first->second;
+    }
+
+    /**
+     * Samples an outcome of the given table, given a number drawn uniformly
+     * from [0, 1).
+     */
+    static const Entry& sample(const Table& table, double u)
+    {
+        return table.entries[
+            mdplib::sampleAlias(table.aliases, table.size, u)];
+    }
+
+    /**
+     * Removes all tables.
+     */
+    void clear()
+    {
+        tables_.clear();
+        entries_.clear();
+        aliases_.clear();
+    }
+
+    size_t size() const { return tables_.size(); }
+};
+
+}   // namespace mlcore
+
+#endif // MDPLIB_SAMPLERCACHE_H
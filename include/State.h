@@ -1,7 +1,10 @@
 #ifndef MDPLIB_STATE_H
 #define MDPLIB_STATE_H
 
+#include <atomic>
+#include <cstdint>
 #include <iostream>
+#include <limits>
 #include <list>
 #include <string>
 #include <unordered_map>
@@ -10,6 +13,8 @@
 #include "Action.h"
 #include "MDPLib.h"
 
+#include "util/hash.h"
+
 #define su_state first
 #define su_prob second
 
@@ -17,6 +22,7 @@ namespace mlcore
 {
 
 class Problem;
+class ValueStore;
 
 /**
  * Abstract class for states.
@@ -26,17 +32,31 @@ class Problem;
  */
 class State
 {
+    friend class Problem;
+    friend class ValueStore;
+
 protected:
 
     /**
      * A bit mask that is helpful to speed up solvers.
+     *
+     * setBits() and clearBits() are plain read-modify-write operations;
+     * threads that set bits of the same state concurrently must use
+     * setBitsAtomic() instead (see LRTDPSolver::numThreads()).
      */
-    unsigned long bits_;
+    std::atomic<unsigned long> bits_;
 
     /**
      * An estimate of the expected cost of reaching the goal from this state.
+     *
+     * The cost and the best action are atomic so that threads can update
+     * different states (and read any state) without a lock. All accesses use
+     * relaxed ordering, which compiles to plain loads and stores on x86/x64.
+     * The cost and best action are updated independently, so a reader
+     * running concurrently with an update may see the new value of one and
+     * the old value of the other.
      */
-    double cost_;
+    std::atomic<double> cost_;
 
     /**
      * For weighted methods such as weighted-LAO*.
@@ -51,7 +71,7 @@ protected:
     /**
      * An estimate of the best action to reach a goal from this state.
      */
-    Action* bestAction_;
+    std::atomic<Action*> bestAction_;
 
     /**
      * An estimate of the number of steps needed to find a state with high
@@ -72,7 +92,31 @@ protected:
     /**
     * Whether this state was found to be a dead-end or not.
     */
-    bool deadEnd_;
+    std::atomic<bool> deadEnd_;
+
+    /**
+     * A dense index assigned to this state by the problem that stores it.
+     * Stored states are numbered contiguously from 0 (see Problem::addState).
+     */
+    uint32_t index_;
+
+    /**
+     * True if the state was created in the state arena of its problem
+     * (see Problem::newState()).
+     */
+    bool inArena_;
+
+    /**
+     * The epoch of the last search that visited this state
+     * (see newVisitEpoch()).
+     */
+    std::atomic<uint32_t> visitEpoch_;
+
+    /**
+     * The cost estimated by the heuristic of the problem, computed the first
+     * time it is needed (see heuristicCost()), or NaN if it hasn't been.
+     */
+    mutable std::atomic<double> heuristicCost_;
 
     virtual std::ostream& print(std::ostream& os) const =0;
 
@@ -89,7 +133,11 @@ public:
               problem_(nullptr),
               deadEnd_(false),
               residualDistance_(mdplib::no_distance),
-              depth_(mdplib::no_distance)
+              depth_(mdplib::no_distance),
+              index_(mdplib::no_index),
+              inArena_(false),
+              visitEpoch_(0),
+              heuristicCost_(std::numeric_limits<double>::quiet_NaN())
     { }
 
     virtual ~State() {}
@@ -114,6 +162,51 @@ public:
      */
     virtual int hashValue() const =0;
 
+    /**
+     * A 64-bit hash of the state, used by Problem to store states (see
+     * StateTable). It's computed once per lookup and cached with the stored
+     * states. The default mixes the bits of hashValue(); domains whose
+     * hashValue() collides often should override it.
+     *
+     * @return A 64-bit hash value of the state.
+     */
+    virtual uint64_t hash64() const
+    {
+        return mdplib::mix64((uint32_t) hashValue());
+    }
+
+    /**
+     * Packs a key that identifies the state into 64-bit words. Two states of
+     * the same problem must have the same key if and only if they are equal.
+     * Problem hashes and compares the keys of the states it stores instead
+     * of calling hash64() and equals(), which avoids the virtual calls and
+     * pointer chasing of equals().
+     *
+     * If the key has more than size words only the number of words is
+     * returned, and the method is called again with a large enough buffer.
+     *
+     * The default implementation returns 0 (no key).
+     *
+     * @param key The buffer where the key is written.
+     * @param size The number of words available in the buffer.
+     * @return The number of words of the key, or 0 if the state has no key.
+     */
+    virtual unsigned packKey(uint64_t* /* key */, unsigned /* size */) const
+    {
+        return 0;
+    }
+
+    /**
+     * Returns the dense index of this state in the problem that stores it,
+     * or mdplib::no_index if the state has not been stored by a problem.
+     *
+     * @return The dense index of this state.
+     */
+    uint32_t index() const
+    {
+        return index_;
+    }
+
     /**
      * Returns the bit mask associated to this state.
      *
@@ -121,7 +214,7 @@ public:
      */
     long bits() const
     {
-        return bits_;
+        return bits_.load(std::memory_order_relaxed);
     }
 
     /**
@@ -131,7 +224,73 @@ public:
      */
     void setBits(unsigned long bitMask)
     {
-        bits_ |= bitMask;
+        bits_.store(bits_.load(std::memory_order_relaxed) | bitMask,
+                    std::memory_order_relaxed);
+    }
+
+    /**
+     * Activates the bits that are activated in the given bit mask with a
+     * single atomic operation, so that no concurrent call to this method on
+     * the same state is lost. Values and actions written before the call are
+     * visible to any thread that sees the bits with checkBits().
+     *
+     * @param bitMask A mask that specifies the bits to be activated.
+     */
+    void setBitsAtomic(unsigned long bitMask)
+    {
+        bits_.fetch_or(bitMask, std::memory_order_release);
+    }
+
+    /**
+     * Returns a new visit epoch, different from the epoch of any other
+     * search (and from 0, the epoch of states never visited).
+     *
+     * A search that needs to mark the states it visits gets a new epoch and
+     * stamps the states with it (see markVisited()), so that the marks of
+     * previous searches don't need to be cleared. Epochs are unique across
+     * all problems, so states shared by a problem and its wrappers can be
+     * marked by searches on either of them. Since a state holds a single
+     * mark, a search must not start a nested search over the same states
+     * (e.g., from a heuristic) while it relies on its marks.
+     */
+    static uint32_t newVisitEpoch()
+    {
+        static std::atomic<uint32_t> lastEpoch(0);
+        uint32_t epoch = ++lastEpoch;
+        return epoch != 0 ? epoch : ++lastEpoch;
+    }
+
+    /**
+     * Checks if the state was visited by the search with the given epoch.
+     */
+    bool visited(uint32_t epoch) const
+    {
+        return visitEpoch_.load(std::memory_order_relaxed) == epoch;
+    }
+
+    /**
+     * Marks the state as visited by the search with the given epoch.
+     *
+     * @return true if the state hadn't been visited in the given epoch.
+     */
+    bool markVisited(uint32_t epoch)
+    {
+        if (visited(epoch))
+            return false;
+        visitEpoch_.store(epoch, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * Marks the state as visited by the search with the given epoch with
+     * a single atomic operation, so that only one of several threads
+     * marking the state in the same epoch gets true.
+     *
+     * @return true if the state hadn't been visited in the given epoch.
+     */
+    bool markVisitedAtomic(uint32_t epoch)
+    {
+        return visitEpoch_.exchange(epoch, std::memory_order_acq_rel) != epoch;
     }
 
     /**
@@ -141,7 +300,8 @@ public:
      */
     void clearBits(unsigned long bitMask)
     {
-        bits_ &= ~bitMask;
+        bits_.store(bits_.load(std::memory_order_relaxed) & ~bitMask,
+                    std::memory_order_relaxed);
     }
 
     /**
@@ -152,7 +312,7 @@ public:
      */
     bool checkBits(unsigned long bitMask) const
     {
-        return bits_ & bitMask;
+        return bits_.load(std::memory_order_acquire) & bitMask;
     }
 
     /**
@@ -160,7 +320,7 @@ public:
      */
     void markDeadEnd()
     {
-        deadEnd_ = true;
+        deadEnd_.store(true, std::memory_order_relaxed);
     }
 
     /**
@@ -170,7 +330,7 @@ public:
      */
     bool deadEnd() const
     {
-        return deadEnd_;
+        return deadEnd_.load(std::memory_order_relaxed);
     }
 
     /**
@@ -190,7 +350,47 @@ public:
      */
     void setCost(double c)
     {
-        cost_ = c;
+        cost_.store(c, std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns the cost estimated by the heuristic of the problem for this
+     * state (0 if the problem has no heuristic).
+     *
+     * The heuristic is called only the first time; later calls return the
+     * cached value, so cost() and hValue() are cheap for states that haven't
+     * been updated. Threads reading the same new state at the same time may
+     * each call the heuristic once.
+     */
+    double heuristicCost() const;
+
+    /**
+     * Returns true if the heuristic cost of the state has been computed.
+     */
+    bool hasHeuristicCost() const
+    {
+        double h = heuristicCost_.load(std::memory_order_relaxed);
+        return h == h;  // false for NaN
+    }
+
+    /**
+     * Caches the heuristic cost of the state (see
+     * Problem::computeHeuristics()).
+     */
+    void heuristicCost(double h)
+    {
+        heuristicCost_.store(h, std::memory_order_relaxed);
+    }
+
+    /**
+     * Forgets the heuristic cost of the state, so that the heuristic is called
+     * again the next time it is needed. Must be called if the heuristic
+     * changes (see Problem::clearHeuristicCosts()).
+     */
+    void clearHeuristicCost()
+    {
+        heuristicCost_.store(std::numeric_limits<double>::quiet_NaN(),
+                             std::memory_order_relaxed);
     }
 
     /**
@@ -234,7 +434,7 @@ public:
      */
     Action* bestAction() const
     {
-        return bestAction_;
+        return bestAction_.load(std::memory_order_relaxed);
     }
 
     /**
@@ -245,7 +445,7 @@ public:
      */
     void setBestAction(Action* a)
     {
-        bestAction_ = a;
+        bestAction_.store(a, std::memory_order_relaxed);
     }
 
 
@@ -296,9 +496,9 @@ public:
      */
     void reset()
     {
-        bits_ = 0;
-        cost_ = mdplib::dead_end_cost + 1;
-        bestAction_ = nullptr;
+        bits_.store(0, std::memory_order_relaxed);
+        setCost(mdplib::dead_end_cost + 1);
+        setBestAction(nullptr);
         depth_ = mdplib::no_distance;
         residualDistance_ = mdplib::no_distance;
     }
@@ -0,0 +1,505 @@
+#ifndef MDPLIB_STATETABLE_H
+#define MDPLIB_STATETABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "MDPLib.h"
+#include "State.h"
+
+#include "util/hash.h"
+
+namespace mlcore
+{
+
+/**
+ * A set of states implemented as a flat open-addressing hash table with
+ * linear probing.
+ *
+ * The table is used by Problem to store the states it generates. Each slot
+ * holds the 64-bit hash of its state (see State::hash64()), computed once
+ * when the state is inserted, so probing compares hashes before calling
+ * State::equals() and growing the table never hashes states again.
+ *
+ * If the states provide packed keys (see State::packKey()), the keys are
+ * hashed and compared instead, and the keys of the stored states are kept
+ * by the table. All states stored in a table are expected to either provide
+ * keys or not.
+ *
+ * The slots are split in shards selected by the high bits of the hashes,
+ * each with its own lock, so that several threads can insert and look up
+ * states at the same time when concurrent() is enabled; they only wait for
+ * each other if they access the same shard. The stored states get dense
+ * positions from an atomic counter, and are kept in a directory of blocks
+ * that never move.
+ *
+ * Iteration visits the states in the order of their positions, which is
+ * the insertion order if the states were inserted by a single thread.
+ * States can't be removed individually, and iteration, clear(), and the
+ * concurrent() flag itself are not thread-safe.
+ */
+class StateTable
+{
+private:
+    /* The number of key words that fit in the buffer used for lookups. */
+    static const unsigned local_key_size = 16;
+
+    /* The number of shards is 2^shard_bits. */
+    static const unsigned shard_bits = 6;
+    static const size_t num_shards = size_t(1) << shard_bits;
+
+    /*
+     * Block b of the directory holds the states at positions
+     * [first_block * (2^b - 1), first_block * (2^(b + 1) - 1)), so that
+     * max_blocks blocks hold every 32-bit position.
+     */
+    static const unsigned first_block_bits = 10;
+    static const size_t first_block = size_t(1) << first_block_bits;
+    static const unsigned max_blocks = 33 - first_block_bits;
+
+    struct Slot {
+        /* The hash of the state. */
+        uint64_t hash;
+
+        /* The position of the state, or no_index if the slot is empty. */
+        uint32_t entry;
+
+        /*
+         * The offset of the key of the state in the keys of the shard, or
+         * no_index if the state has no key.
+         */
+        uint32_t key;
+    };
+
+    struct Shard {
+        /* Serializes access to the shard while concurrent_ is set. */
+        mutable std::mutex mutex_;
+
+        /* The slots of the shard. The capacity is a power of two. */
+        std::vector<Slot> slots_;
+
+        /* The number of states stored in the shard. */
+        size_t size_;
+
+        /*
+         * The packed keys of the states stored in the shard, each preceded
+         * by its number of words.
+         */
+        std::vector<uint64_t> keys_;
+
+        Shard() : size_(0) { }
+    };
+
+    Shard shards_[num_shards];
+
+    /* The blocks of the directory, allocated when first needed. */
+    std::atomic<State**> blocks_[max_blocks];
+
+    /* The number of stored states. */
+    std::atomic<uint32_t> size_;
+
+    /* If true, every access to a shard locks it. */
+    bool concurrent_;
+
+    /*
+     * The key of a state being looked up. Small keys are stored in local_,
+     * larger ones in heap_.
+     */
+    struct Key {
+        uint64_t local_[local_key_size];
+        std::vector<uint64_t> heap_;
+        const uint64_t* words_;
+        unsigned size_;
+    };
+
+    /*
+     * Computes the hash of s, storing its packed key (if any) in key.
+     * Returns true if s provided a key.
+     */
+    static bool hash(State* s, Key& key, uint64_t& h)
+    {
+        key.size_ = s->packKey(key.local_, local_key_size);
+        key.words_ = key.local_;
+        if (key.size_ > local_key_size) {
+            key.heap_.resize(key.size_);
+            s->packKey(key.heap_.data(), key.size_);
+            key.words_ = key.heap_.data();
+        }
+        if (key.size_ > 0) {
+            h = mdplib::hashWords(key.words_, key.size_);
+            return true;
+        }
+        h = s->hash64();
+        return false;
+    }
+
+    /* Returns the shard holding the states with the given hash. */
+    Shard& shard(uint64_t h)
+    {
+        return shards_[h >> (64 - shard_bits)];
+    }
+
+    const Shard& shard(uint64_t h) const
+    {
+        return shards_[h >> (64 - shard_bits)];
+    }
+
+    /* Returns the block and the offset in it of the given position. */
+    static void locate(uint32_t entry, size_t& block, size_t& offset)
+    {
+        uint64_t i = uint64_t(entry) + first_block;
+        block = 63 - __builtin_clzll(i) - first_block_bits;
+        offset = i - (first_block << block);
+    }
+
+    /* Returns the directory slot of the state at the given position. */
+    State*& at(uint32_t entry) const
+    {
+        size_t block, offset;
+        locate(entry, block, offset);
+        return blocks_[block].load(std::memory_order_acquire)[offset];
+    }
+
+    /* Allocates the block of the given position unless it exists. */
+    void allocate(uint32_t entry)
+    {
+        size_t block, offset;
+        locate(entry, block, offset);
+        State** current = blocks_[block].load(std::memory_order_acquire);
+        if (current != nullptr)
+            return;
+        State** fresh = new State*[first_block << block];
+        if (!blocks_[block].compare_exchange_strong(current, fresh))
+            delete[] fresh;     // another thread allocated it first
+    }
+
+    /*
+     * Returns the slot of the shard holding the state equal to s (with the
+     * given hash and key), or the empty slot where it would be inserted.
+     * The shard must have at least one slot.
+     */
+    size_t probe(const Shard& sh, State* s, uint64_t h, const Key* key) const
+    {
+        size_t mask = sh.slots_.size() - 1;
+        size_t i = h & mask;
+        while (true) {
+            const Slot& slot = sh.slots_[i];
+            if (slot.entry == mdplib::no_index)
+                return i;
+            if (slot.hash == h && equal(sh, slot, s, key))
+                return i;
+            i = (i + 1) & mask;
+        }
+    }
+
+    bool equal(const Shard& sh, const Slot& slot, State* s,
+               const Key* key) const
+    {
+        if (key == nullptr)
+            return at(slot.entry)->equals(s);
+        if (slot.key == mdplib::no_index)
+            return false;   // the stored state has no key
+        const uint64_t* stored = sh.keys_.data() + slot.key;
+        if (stored[0] != key->size_)
+            return false;
+        for (unsigned i = 0; i < key->size_; i++) {
+            if (stored[i + 1] != key->words_[i])
+                return false;
+        }
+        return true;
+    }
+
+    /*
+     * Returns the position of the state equal to s (or with the given key
+     * if s is null) in the shard of h, or no_index.
+     */
+    uint32_t lookup(State* s, uint64_t h, const Key* key) const
+    {
+        const Shard& sh = shard(h);
+        std::unique_lock<std::mutex> lock(sh.mutex_, std::defer_lock);
+        if (concurrent_)
+            lock.lock();
+        if (sh.size_ == 0)
+            return mdplib::no_index;
+        return sh.slots_[probe(sh, s, h, key)].entry;
+    }
+
+    /* Returns the position of the state with the given key, or no_index. */
+    uint32_t lookup(const uint64_t* words, unsigned size) const
+    {
+        Key key;
+        key.words_ = words;
+        key.size_ = size;
+        return lookup(nullptr, mdplib::hashWords(words, size), &key);
+    }
+
+    /* Returns the position of the state equal to s, or no_index. */
+    uint32_t lookup(State* s) const
+    {
+        Key key;
+        uint64_t h;
+        bool keyed = hash(s, key, h);
+        return lookup(s, h, keyed ? &key : nullptr);
+    }
+
+    /* Doubles the number of slots of the shard (or allocates the first). */
+    static void grow(Shard& sh)
+    {
+        std::vector<Slot> old;
+        old.swap(sh.slots_);
+        size_t capacity = old.empty() ? 16 : 2 * old.size();
+        Slot empty = {0, mdplib::no_index, mdplib::no_index};
+        sh.slots_.assign(capacity, empty);
+        size_t mask = capacity - 1;
+        for (const Slot& slot : old) {
+            if (slot.entry == mdplib::no_index)
+                continue;
+            size_t i = slot.hash & mask;
+            while (sh.slots_[i].entry != mdplib::no_index)
+                i = (i + 1) & mask;
+            sh.slots_[i] = slot;
+        }
+    }
+
+public:
+    /**
+     * Visits the stored states in the order of their positions.
+     */
+    class iterator
+    {
+    private:
+        const StateTable* table_;
+        uint32_t entry_;
+        State** current_;
+        State** blockEnd_;
+
+        /* Points current_ to the directory slot of entry_. */
+        void seek()
+        {
+            size_t block, offset;
+            locate(entry_, block, offset);
+            State** states = table_->blocks_[block].load(
+                std::memory_order_acquire);
+            current_ = states + offset;
+            blockEnd_ = states + (first_block << block);
+        }
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef State* value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef State* const* pointer;
+        typedef State* const& reference;
+
+        iterator() : table_(nullptr), entry_(0),
+                     current_(nullptr), blockEnd_(nullptr) { }
+
+        iterator(const StateTable* table, uint32_t entry)
+            : table_(table), entry_(entry),
+              current_(nullptr), blockEnd_(nullptr)
+        {
+            if (entry_ < table_->size())
+                seek();
+        }
+
+        reference operator*() const { return *current_; }
+
+        pointer operator->() const { return current_; }
+
+        iterator& operator++()
+        {
+            entry_++;
+            if (++current_ == blockEnd_ && entry_ < table_->size())
+                seek();
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        bool operator==(const iterator& other) const
+        {
+            return entry_ == other.entry_;
+        }
+
+        bool operator!=(const iterator& other) const
+        {
+            return entry_ != other.entry_;
+        }
+    };
+
+    typedef iterator const_iterator;
+
+    StateTable() : size_(0), concurrent_(false)
+    {
+        for (size_t b = 0; b < max_blocks; b++)
+            blocks_[b] = nullptr;
+    }
+
+    StateTable(const StateTable&) = delete;
+
+    StateTable& operator=(const StateTable&) = delete;
+
+    ~StateTable()
+    {
+        for (size_t b = 0; b < max_blocks; b++)
+            delete[] blocks_[b].load();
+    }
+
+    /**
+     * Enables or disables the locking of the shards, which must be enabled
+     * while several threads call insert() or get() on the table. Must not
+     * be called while other threads access the table.
+     */
+    void concurrent(bool value)
+    {
+        concurrent_ = value;
+    }
+
+    /**
+     * Inserts the given state unless an equal state is already stored.
+     *
+     * If s is inserted, onInsert(s, position) is called before any other
+     * thread can find s in the table, with the position of s (its index in
+     * the iteration order).
+     *
+     * @return The stored state equal to s, and true if s was inserted.
+     */
+    template<typename OnInsert>
+    std::pair<State*, bool> insert(State* s, OnInsert onInsert)
+    {
+        Key key;
+        uint64_t h;
+        bool keyed = hash(s, key, h);
+        Shard& sh = shard(h);
+        std::unique_lock<std::mutex> lock(sh.mutex_, std::defer_lock);
+        if (concurrent_)
+            lock.lock();
+        // Keeps the load factor at most 1/2.
+        if (2 * (sh.size_ + 1) > sh.slots_.size())
+            grow(sh);
+        size_t i = probe(sh, s, h, keyed ? &key : nullptr);
+        if (sh.slots_[i].entry != mdplib::no_index)
+            return std::make_pair(at(sh.slots_[i].entry), false);
+        uint32_t entry = size_.fetch_add(1, std::memory_order_relaxed);
+        allocate(entry);
+        at(entry) = s;
+        onInsert(s, entry);
+        sh.slots_[i].hash = h;
+        sh.slots_[i].key = mdplib::no_index;
+        if (keyed) {
+            sh.slots_[i].key = sh.keys_.size();
+            sh.keys_.push_back(key.size_);
+            sh.keys_.insert(sh.keys_.end(),
+                            key.words_, key.words_ + key.size_);
+        }
+        sh.slots_[i].entry = entry;
+        sh.size_++;
+        return std::make_pair(s, true);
+    }
+
+    std::pair<State*, bool> insert(State* s)
+    {
+        return insert(s, [] (State*, uint32_t) { });
+    }
+
+    /**
+     * Returns the stored state equal to s, or nullptr if there is none.
+     */
+    State* get(State* s) const
+    {
+        uint32_t entry = lookup(s);
+        return entry == mdplib::no_index ? nullptr : at(entry);
+    }
+
+    /**
+     * Returns the stored state with the given packed key (see
+     * State::packKey()), or nullptr if there is none.
+     */
+    State* get(const uint64_t* key, unsigned size) const
+    {
+        uint32_t entry = lookup(key, size);
+        return entry == mdplib::no_index ? nullptr : at(entry);
+    }
+
+    /**
+     * Returns the state at the given position, in [0, size()).
+     */
+    State* state(uint32_t position) const
+    {
+        return at(position);
+    }
+
+    /**
+     * Returns an iterator to the stored state equal to s, or end() if there
+     * is none.
+     */
+    iterator find(State* s) const
+    {
+        uint32_t entry = lookup(s);
+        return entry == mdplib::no_index ? end() : iterator(this, entry);
+    }
+
+    /**
+     * Removes all states from the table (without deleting them), keeping
+     * the blocks of the directory.
+     */
+    void clear()
+    {
+        for (Shard& sh : shards_) {
+            sh.slots_.clear();
+            sh.keys_.clear();
+            sh.size_ = 0;
+        }
+        size_ = 0;
+    }
+
+    /**
+     * Returns the number of bytes used by the table (not including the
+     * states themselves). Safe to call while other threads insert states
+     * if concurrent() is enabled.
+     */
+    size_t memoryUsage() const
+    {
+        size_t bytes = 0;
+        for (const Shard& sh : shards_) {
+            std::unique_lock<std::mutex> lock(sh.mutex_, std::defer_lock);
+            if (concurrent_)
+                lock.lock();
+            bytes += sh.slots_.capacity() * sizeof(Slot)
+                + sh.keys_.capacity() * sizeof(uint64_t);
+        }
+        for (size_t b = 0; b < max_blocks; b++) {
+            if (blocks_[b].load() != nullptr)
+                bytes += (first_block << b) * sizeof(State*);
+        }
+        return bytes;
+    }
+
+    size_t count(State* s) const { return get(s) != nullptr ? 1 : 0; }
+
+    /**
+     * Returns the number of stored states. Safe to call while other threads
+     * insert states.
+     */
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+    bool empty() const { return size() == 0; }
+
+    iterator begin() const { return iterator(this, 0); }
+
+    iterator end() const { return iterator(this, size()); }
+};
+
+}   // namespace mlcore
+
+#endif // MDPLIB_STATETABLE_H
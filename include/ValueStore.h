@@ -0,0 +1,151 @@
+#ifndef MDPLIB_VALUESTORE_H
+#define MDPLIB_VALUESTORE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Action.h"
+#include "MDPLib.h"
+#include "State.h"
+
+namespace mlcore
+{
+
+class Problem;
+
+/**
+ * A struct-of-arrays storage for the values that solvers keep for each state
+ * (cost, best action, bits, g-value, h-value, residual distance, depth and
+ * dead-end flag).
+ *
+ * The values of a state are stored at the position given by the state's dense
+ * index (see State::index()), so that solvers sweeping over many states touch
+ * contiguous memory instead of the scattered state objects.
+ *
+ * A problem owns at most one store (see Problem::useValueStore()). While the
+ * store is enabled, it holds the authoritative copy of the values for the
+ * solvers that support it (currently bellmanUpdate() and VISolver); the
+ * values are written back into the state objects by calling
+ * Problem::syncValueStore().
+ */
+class ValueStore
+{
+private:
+    /* The problem whose states are stored. */
+    Problem* problem_;
+
+    std::vector<double> cost_;
+    std::vector<double> gValue_;
+    std::vector<double> hValue_;
+    std::vector<double> residualDistance_;
+    std::vector<double> depth_;
+    std::vector<Action*> bestAction_;
+    std::vector<unsigned long> bits_;
+    std::vector<unsigned char> deadEnd_;
+
+public:
+    ValueStore(Problem* problem) : problem_(problem) { }
+
+    /**
+     * Returns the number of states in the store.
+     */
+    size_t size() const
+    {
+        return cost_.size();
+    }
+
+    /**
+     * Copies the values stored in the given state object into the store,
+     * growing the store if necessary.
+     */
+    void load(State* s)
+    {
+        uint32_t i = s->index_;
+        if (i >= size()) {
+            size_t n = i + 1;
+            cost_.resize(n);
+            gValue_.resize(n);
+            hValue_.resize(n);
+            residualDistance_.resize(n);
+            depth_.resize(n);
+            bestAction_.resize(n);
+            bits_.resize(n);
+            deadEnd_.resize(n);
+        }
+        cost_[i] = s->cost_.load(std::memory_order_relaxed);
+        gValue_[i] = s->gValue_;
+        hValue_[i] = s->hValue_;
+        residualDistance_[i] = s->residualDistance_;
+        depth_[i] = s->depth_;
+        bestAction_[i] = s->bestAction_.load(std::memory_order_relaxed);
+        bits_[i] = s->bits_.load(std::memory_order_relaxed);
+        deadEnd_[i] = s->deadEnd_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Copies the values in the store into the given state object.
+     */
+    void store(State* s) const
+    {
+        uint32_t i = s->index_;
+        s->setCost(cost_[i]);
+        s->gValue_ = gValue_[i];
+        s->hValue_ = hValue_[i];
+        s->residualDistance_ = residualDistance_[i];
+        s->depth_ = depth_[i];
+        s->setBestAction(bestAction_[i]);
+        s->bits_.store(bits_[i], std::memory_order_relaxed);
+        s->deadEnd_.store(deadEnd_[i], std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns the estimated cost of the state with the given index.
+     * Mirrors State::cost(): the heuristic is used for states that have not
+     * been updated yet.
+     */
+    double cost(uint32_t i) const;
+
+    void setCost(uint32_t i, double c) { cost_[i] = c; }
+
+    Action* bestAction(uint32_t i) const { return bestAction_[i]; }
+
+    void setBestAction(uint32_t i, Action* a) { bestAction_[i] = a; }
+
+    unsigned long bits(uint32_t i) const { return bits_[i]; }
+
+    void setBits(uint32_t i, unsigned long mask) { bits_[i] |= mask; }
+
+    void clearBits(uint32_t i, unsigned long mask) { bits_[i] &= ~mask; }
+
+    bool checkBits(uint32_t i, unsigned long mask) const
+    {
+        return bits_[i] & mask;
+    }
+
+    double gValue(uint32_t i) const { return gValue_[i]; }
+
+    void gValue(uint32_t i, double g) { gValue_[i] = g; }
+
+    double hValue(uint32_t i) const { return hValue_[i]; }
+
+    void hValue(uint32_t i, double h) { hValue_[i] = h; }
+
+    double residualDistance(uint32_t i) const { return residualDistance_[i]; }
+
+    void residualDistance(uint32_t i, double value)
+    {
+        residualDistance_[i] = value;
+    }
+
+    double depth(uint32_t i) const { return depth_[i]; }
+
+    void depth(uint32_t i, double value) { depth_[i] = value; }
+
+    bool deadEnd(uint32_t i) const { return deadEnd_[i]; }
+
+    void markDeadEnd(uint32_t i) { deadEnd_[i] = true; }
+};
+
+}
+
+#endif // MDPLIB_VALUESTORE_H
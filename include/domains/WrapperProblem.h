@@ -41,6 +41,11 @@ private:
      */
      mlcore::StateSet* overrideStates_ = nullptr;
 
+    /*
+     * The override states, in the form returned by states().
+     */
+     mlcore::StateTable overrideTable_;
+
     /*
      * A set of goals that replace the original goal in problem_.
      */
@@ -183,7 +188,7 @@ public:
     /**
      * Overrides method from Problem.
      */
-    virtual mlcore::StateSet& states();
+    virtual mlcore::StateTable& states();
 
     /**
      * Overrides method from Problem.
@@ -25,6 +25,14 @@ private:
     std::vector< std::vector <double> > probs_;
     CTPState* absorbing_;
 
+    /*
+     * The actions, in the same order as actions_: the action moving from
+     * i to j is actionTable_[i * n + j], where n is the number of vertices,
+     * and the last action is the one applicable at goal and absorbing
+     * states.
+     */
+    std::vector<mlcore::Action*> actionTable_;
+
     void init();
 
 public:
@@ -78,6 +86,18 @@ public:
     virtual std::list<mlcore::Successor>
     transition(mlcore::State* s, mlcore::Action* a);
 
+    /**
+     * Overrides method from Problem.
+     */
+    virtual mlcore::SuccessorView
+    successors(mlcore::State* s, mlcore::Action* a);
+
+    /**
+     * Overrides method from Problem. Only the actions leaving the current
+     * location are tested, instead of all n^2 + 1 actions.
+     */
+    virtual mlcore::Expansion expand(mlcore::State* s);
+
     /**
      * Overrides method from Problem.
      */
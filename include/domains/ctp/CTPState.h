@@ -1,6 +1,7 @@
 #ifndef MDPLIB_CTPSTATE_H
 #define MDPLIB_CTPSTATE_H
 
+#include <atomic>
 #include <vector>
 #include <cassert>
 #include <unordered_set>
@@ -25,7 +26,9 @@ private:
     int location_;
     std::vector< std::vector <unsigned char> > status_;
     std::unordered_set<int> explored_;
-    unsigned char badWeather_ = ctp::UNKNOWN;
+    // Cached result of badWeather(), computed by the first caller (atomic so
+    // that solvers can call badWeather() from several threads).
+    std::atomic<unsigned char> badWeather_{ctp::UNKNOWN};
 
     virtual std::ostream& print(std::ostream& os) const;
 
@@ -163,6 +166,28 @@ public:
      * Overrides method from State.
      */
     virtual int hashValue() const;
+
+    /**
+     * Overrides method from State.
+     */
+    virtual unsigned packKey(uint64_t* key, unsigned size) const;
+
+    /**
+     * Writes the packed key (see packKey()) of the state reached from this
+     * state by moving to the given location and marking it as explored,
+     * without changing the status of any road. This state must not be the
+     * absorbing state.
+     *
+     * @return The number of words of the key.
+     */
+    unsigned packMoveKey(int to, uint64_t* key, unsigned size) const;
+
+    /**
+     * Sets the status of the road from i to j in a key written by packKey()
+     * for a problem with n vertices.
+     */
+    static void setKeyStatus(uint64_t* key, int n,
+                             int i, int j, unsigned char status);
 };
 
 #endif // MDPLIB_CTPSTATE_H
@@ -0,0 +1,38 @@
+#ifndef MDPLIB_GWDIJKSTRAHEUR_H
+#define MDPLIB_GWDIJKSTRAHEUR_H
+
+#include <vector>
+
+#include "../../Heuristic.h"
+#include "../../State.h"
+
+#include "GridWorldProblem.h"
+
+/**
+ * A heuristic for grid worlds that assumes every move can end in any of
+ * the cells the action may lead to (the all-outcomes determinization).
+ * This results in an admissible heuristic that, unlike the Manhattan
+ * distance, accounts for walls, holes and dead-ends.
+ *
+ * The costs of all cells are computed when the heuristic is constructed,
+ * with a single Dijkstra search from all goals at once, and stored in a
+ * dense table, so that cost() is a single array lookup. Cells from which
+ * no goal can be reached get mdplib::dead_end_cost.
+ */
+class GWDijkstraHeuristic : public mlcore::Heuristic
+{
+private:
+    int width_;
+
+    /* The costs of the cells, in row-major order. */
+    std::vector<double> costs_;
+
+public:
+    GWDijkstraHeuristic(GridWorldProblem* problem);
+
+    virtual ~GWDijkstraHeuristic() { }
+
+    virtual double cost(const mlcore::State* s);
+};
+
+#endif // MDPLIB_GWDIJKSTRAHEUR_H
@@ -0,0 +1,125 @@
+#ifndef MPDLIB_GRIDWORLDGENERATOR_H
+#define MPDLIB_GRIDWORLDGENERATOR_H
+
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "GridWorldMap.h"
+
+/**
+ * Generates random grid world maps of arbitrary size.
+ *
+ * The type of every cell is a deterministic function of the seed and the
+ * cell's position, so a map can be written row by row without holding it
+ * in memory (see write()) and the same map is obtained when it is built
+ * directly (see GridWorldProblem).
+ *
+ * Each cell is independently a wall, a hole or a dead-end with the given
+ * densities, and free otherwise. The start cell and the goals are always
+ * free. If no goals are added, there is a single goal at the corner
+ * opposite to the start. Unless disabled, the generator also clears a
+ * corridor of walls and dead-ends along the start's row and along the
+ * column of each goal (up to the start's row), so that every goal can be
+ * reached from the start regardless of the densities.
+ */
+class GridWorldGenerator
+{
+private:
+    int width_;
+    int height_;
+    uint64_t seed_;
+    double walls_;
+    double holes_;
+    double deadEnds_;
+    int x0_;
+    int y0_;
+    bool corridors_;
+
+    /* The goals added explicitly or at random. */
+    std::vector<std::pair<int, int> > goals_;
+
+    /* The goals of the map, as sorted cell indices. */
+    std::vector<uint64_t> goalCells_;
+
+    /* The rows [top, bottom] kept free in each column. */
+    std::vector<int> top_;
+    std::vector<int> bottom_;
+
+    void update();
+
+    uint64_t index(int x, int y) const
+    {
+        return static_cast<uint64_t>(y) * width_ + x;
+    }
+
+public:
+    /**
+     * Constructs a generator for maps of the given dimensions, with no
+     * obstacles and the start at (0, 0).
+     */
+    GridWorldGenerator(int width, int height, uint64_t seed = 0);
+
+    int width() const { return width_; }
+
+    int height() const { return height_; }
+
+    int x0() const { return x0_; }
+
+    int y0() const { return y0_; }
+
+    /**
+     * Sets the fraction of cells that are walls.
+     */
+    void walls(double density) { walls_ = density; }
+
+    /**
+     * Sets the fraction of cells that are holes.
+     */
+    void holes(double density) { holes_ = density; }
+
+    /**
+     * Sets the fraction of cells that are dead-ends.
+     */
+    void deadEnds(double density) { deadEnds_ = density; }
+
+    /**
+     * Sets the start cell.
+     */
+    void start(int x, int y);
+
+    /**
+     * Adds a goal at (x, y).
+     */
+    void addGoal(int x, int y);
+
+    /**
+     * Adds n goals at distinct random cells, other than the start and the
+     * goals already added.
+     */
+    void addRandomGoals(int n);
+
+    /**
+     * Sets whether corridors are cleared between the start and the goals.
+     */
+    void corridors(bool value) { corridors_ = value; update(); }
+
+    /**
+     * Returns the goals of the map.
+     */
+    std::vector<std::pair<int, int> > goals() const;
+
+    /**
+     * Returns the type of the cell at (x, y).
+     */
+    unsigned char cell(int x, int y) const;
+
+    /**
+     * Writes the map in the text format read by GridWorldProblem, one row
+     * at a time.
+     */
+    void write(std::ostream& os) const;
+};
+
+#endif // MPDLIB_GRIDWORLDGENERATOR_H
@@ -0,0 +1,106 @@
+#ifndef MPDLIB_GRIDWORLDMAP_H
+#define MPDLIB_GRIDWORLDMAP_H
+
+#include <cstddef>
+#include <vector>
+
+namespace gridworld
+{
+    /* The types of the cells of a grid world map. */
+    const unsigned char FREE = 0;
+    const unsigned char WALL = 1;
+    const unsigned char HOLE = 2;
+    const unsigned char DEAD_END = 3;
+    const unsigned char GOAL = 4;
+}
+
+/**
+ * The cells of a grid world, stored as a dense row-major grid with one byte
+ * per cell, so that looking up a cell is a single memory access.
+ */
+class GridWorldMap
+{
+private:
+    int width_;
+    int height_;
+    std::vector<unsigned char> cells_;
+
+public:
+    GridWorldMap() : width_(0), height_(0) { }
+
+    /**
+     * Constructs a map with the given dimensions and all cells free.
+     */
+    GridWorldMap(int width, int height)
+        : width_(width), height_(height),
+          cells_(static_cast<size_t>(width) * height, gridworld::FREE) { }
+
+    int width() const { return width_; }
+
+    int height() const { return height_; }
+
+    /**
+     * Returns true if (x, y) is inside the map.
+     */
+    bool contains(int x, int y) const
+    {
+        return x >= 0 && x < width_ && y >= 0 && y < height_;
+    }
+
+    /**
+     * Returns the type of the cell at (x, y), which must be inside the map.
+     */
+    unsigned char cell(int x, int y) const
+    {
+        return cells_[static_cast<size_t>(y) * width_ + x];
+    }
+
+    /**
+     * Sets the type of the cell at (x, y), which must be inside the map.
+     */
+    void cell(int x, int y, unsigned char type)
+    {
+        cells_[static_cast<size_t>(y) * width_ + x] = type;
+    }
+
+    /**
+     * Appends a row of free cells at the bottom of the map (the first row
+     * added sets the width) and returns a pointer to its cells.
+     */
+    unsigned char* addRow(int width)
+    {
+        if (height_ == 0)
+            width_ = width;
+        cells_.resize(cells_.size() + width_, gridworld::FREE);
+        height_++;
+        return &cells_[cells_.size() - width_];
+    }
+
+    /**
+     * Returns the type of cell represented by the given character of the
+     * text format (see GridWorldProblem), or -1 for unknown characters.
+     * The start character 'S' and spaces represent free cells.
+     */
+    static int cellType(char c)
+    {
+        switch (c) {
+            case '.': case 'S': case ' ': return gridworld::FREE;
+            case 'x': return gridworld::WALL;
+            case '@': return gridworld::HOLE;
+            case 'D': return gridworld::DEAD_END;
+            case 'G': return gridworld::GOAL;
+        }
+        return -1;
+    }
+
+    /**
+     * Returns the character representing the given type of cell.
+     */
+    static char symbol(unsigned char type)
+    {
+        static const char symbols[] = {'.', 'x', '@', 'D', 'G'};
+        return symbols[type];
+    }
+};
+
+#endif // MPDLIB_GRIDWORLDMAP_H
@@ -1,8 +1,8 @@
 #ifndef MPDLIB_GRIDWORLDPROBLEM_H
 #define MPDLIB_GRIDWORLDPROBLEM_H
 
-#include <unordered_set>
-
+#include "GridWorldGenerator.h"
+#include "GridWorldMap.h"
 #include "GridWorldState.h"
 
 #include "../../Problem.h"
@@ -10,6 +10,7 @@
 #include "../../Action.h"
 #include "../../util/general.h"
 
+class GWDijkstraHeuristic;
 class GWManhattanHeuristic;
 
 namespace gridworld
@@ -32,9 +33,13 @@ namespace gridworld
  *   - A 'D' character represents a dead-end.
  *   - A 'S' character represents the start cell.
  *   - A 'G' character represents a goal cell (multiple goals are allowed).
+ *
+ * All lines of the file must have the same length. Large random maps can
+ * also be created directly with a GridWorldGenerator.
  */
 class GridWorldProblem : public mlcore::Problem
 {
+    friend class GWDijkstraHeuristic;
     friend class GWManhattanHeuristic;
 
 private:
@@ -47,12 +52,10 @@ private:
     bool allDirections_;
     PairDoubleMap* goals_;
     mlcore::State* absorbing;
-    IntPairSet walls;
-    IntPairSet holes;
-    IntPairSet dead_ends;
+    GridWorldMap map_;
 
     void addSuccessor(GridWorldState* state,
-                      std::list<mlcore::Successor>& successors,
+                      mlcore::SuccessorView& successors,
                       int val,
                       int limit,
                       int newx,
@@ -61,6 +64,8 @@ private:
 
     void addAllActions();
 
+    void markGoals();
+
     bool gridGoal(GridWorldState* s) const;
 public:
     /**
@@ -81,6 +86,15 @@ public:
                      double holeCost = 100.0,
                      bool allDirections = false);
 
+    /**
+     * Constructs a grid world with the map produced by the given generator.
+     * The constructor also receives the cost of the actions.
+     */
+    GridWorldProblem(const GridWorldGenerator& generator,
+                     double actionCost = 1.0,
+                     double holeCost = 100.0,
+                     bool allDirections = false);
+
     /**
      * Constructs a grid world with the specified width, height,
      * goal states, initial state (x0,y0).
@@ -101,6 +115,11 @@ public:
         delete goals_;
     }
 
+    /**
+     * Returns the map of the grid world.
+     */
+    const GridWorldMap& map() const { return map_; }
+
     /**
      * Overrides method from Problem.
      */
@@ -112,6 +131,12 @@ public:
     virtual std::list<mlcore::Successor> transition(mlcore::State* s,
                                                     mlcore::Action* a);
 
+    /**
+     * Overrides method from Problem.
+     */
+    virtual mlcore::SuccessorView successors(mlcore::State* s,
+                                             mlcore::Action* a);
+
     /**
      * Overrides method from Problem.
      */
@@ -50,6 +50,15 @@ public:
 
     virtual bool equals(mlcore::State* other) const;
     virtual int hashValue() const;
+    virtual unsigned packKey(uint64_t* key, unsigned size) const;
+
+    /**
+     * Returns the packed key (a single word) of the state at (x, y).
+     */
+    static uint64_t makeKey(int x, int y)
+    {
+        return (uint64_t) (uint32_t) x << 32 | (uint32_t) y;
+    }
 
     int x() const;
 
@@ -1,6 +1,9 @@
 #ifndef MDPLIB_RTRACKDETHEURISTIC_H
 #define MDPLIB_RTRACKDETHEURISTIC_H
 
+#include <cstdint>
+#include <vector>
+
 #include "../../Heuristic.h"
 
 #include "RacetrackProblem.h"
@@ -9,18 +12,68 @@
  * A deterministic heuristic for the Racetrack domain.
  * The heuristic assumes that for any action, the intended outcome
  * will occur with probability 1.0; this results in an admissible heuristic.
+ *
+ * The deterministic problem is solved with VI when the heuristic is
+ * constructed, and the resulting costs are stored in a dense table indexed
+ * by position and velocity, so that cost() is a single array lookup.
  */
 class RTrackDetHeuristic : public mlcore::Heuristic
 {
 private:
-    RacetrackProblem* detProblem_;
-public:
-    RTrackDetHeuristic(const char* filename);
-    virtual ~RTrackDetHeuristic()
+    /* The size of the track, including the surrounding walls. */
+    int width_;
+    int height_;
+
+    /* The range of velocities covered by the table. */
+    int minVx_;
+    int numVx_;
+    int minVy_;
+    int numVy_;
+
+    /* The costs of the states, indexed by (x, y, vx, vy) (see index()). */
+    std::vector<double> costs_;
+
+    /* The costs of the initial and absorbing states, which have no position. */
+    double initialCost_;
+    double absorbingCost_;
+
+    /* Returns the position in costs_ of the given state, or -1 if none. */
+    long index(int x, int y, int vx, int vy) const
     {
-        delete detProblem_;
+        vx -= minVx_;
+        vy -= minVy_;
+        if (x < 0 || x >= width_ || y < 0 || y >= height_ ||
+                vx < 0 || vx >= numVx_ || vy < 0 || vy >= numVy_)
+            return -1;
+        return ((long(x) * height_ + y) * numVx_ + vx) * numVy_ + vy;
     }
 
+    /* Solves the deterministic problem and fills the table. */
+    void compute(RacetrackProblem* detProblem);
+
+    /*
+     * Loads the table from the given file, returning false if the file
+     * doesn't exist or was written for a different track.
+     */
+    bool load(const char* filename, uint64_t fingerprint);
+
+    /* Writes the table to the given file. */
+    void save(const char* filename, uint64_t fingerprint) const;
+
+public:
+    /**
+     * Creates the heuristic for the track stored in the given file.
+     *
+     * If cacheFilename is not null, the table is read from that file when
+     * it was written for the same track (skipping VI), and otherwise it is
+     * computed and written to the file. The file uses the native byte
+     * order.
+     */
+    RTrackDetHeuristic(const char* filename,
+                       const char* cacheFilename = nullptr);
+
+    virtual ~RTrackDetHeuristic() { }
+
     virtual double cost(const mlcore::State* s);
 };
 
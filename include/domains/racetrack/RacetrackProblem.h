@@ -1,6 +1,8 @@
 #ifndef MDPLIB_RACETRACKPROBLEM_H
 #define MDPLIB_RACETRACKPROBLEM_H
 
+#include <atomic>
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
 #include <list>
@@ -81,17 +83,77 @@ private:
     IntPairSet goals_;
 
     /*
-     * Returns the resulting state of applying the given acceleration to
-     * the given state
+     * Velocities with both components in [-ray_speed, ray_speed] have
+     * their ray-cast results cached in rays_.
      */
-    RacetrackState* resultingState(RacetrackState* rts, int ax, int ay);
+    static const int ray_speed = 12;
+
+    /* The number of cells per row of the track (its longest row). */
+    int rayStride_;
+
+    /*
+     * A direct-mapped cache of the rays cast (see castRay()), shared by all
+     * threads. Each entry is a single word holding the cell, the velocity
+     * and the step of the ray where the car stops, so entries are read and
+     * written atomically without locks. Only the rays actually cast are
+     * stored, and a ray replaces the one stored in its entry, so the size
+     * of the cache is fixed (see resetRays()) however many are cast.
+     */
+    std::vector< std::atomic<uint64_t> > rays_;
+
+    /* Clears the ray-cast cache and sizes it for track_. */
+    void resetRays();
+
+    /*
+     * Follows the line from (x, y) to (x + vx, y + vy) and returns the step
+     * d of the first wall, pothole or goal cell on it, or the last step if
+     * there is none (see rayCell()).
+     */
+    int castRay(int x, int y, int vx, int vy) const;
+
+    /*
+     * Returns the cell where the car ends up when moving from (x, y) with
+     * the given velocity, encoded as x * rayStride_ + y, using the cached
+     * ray-cast results when possible.
+     */
+    uint32_t rayCell(int x, int y, int vx, int vy);
+
+    /*
+     * Returns the stored state with the given position and velocity,
+     * creating it only if it hasn't been stored yet.
+     */
+    mlcore::State* makeState(int x, int y, int vx, int vy);
+
+    /*
+     * Returns the (stored) resulting state of applying the given
+     * acceleration to the given state
+     */
+    mlcore::State* resultingState(RacetrackState* rts, int ax, int ay);
 
     /*
      * A flat transition function where every action has the same number
      * of successors in all states.
      */
-    virtual std::list<mlcore::Successor> flatTransition(mlcore::State* s,
-                                                        mlcore::Action* a);
+    virtual mlcore::SuccessorView flatSuccessors(mlcore::State* s,
+                                                 mlcore::Action* a);
+
+    /*
+     * Compute the successors of the given action in a state other than the
+     * initial, goal and absorbing states, with the regular and the flat
+     * transition functions.
+     */
+    mlcore::SuccessorView actionSuccessors(RacetrackState* rts,
+                                           RacetrackAction* rta);
+    mlcore::SuccessorView flatActionSuccessors(RacetrackState* rts,
+                                               RacetrackAction* rta);
+
+    /*
+     * Returns the successors of the given action from the cache of the
+     * state, first computing and caching those of all applicable actions
+     * if the state has no cache yet.
+     */
+    mlcore::SuccessorView cachedSuccessors(RacetrackState* rts,
+                                           RacetrackAction* rta);
 
 public:
 
@@ -102,9 +164,17 @@ public:
 
     virtual ~RacetrackProblem() {}
 
+    /**
+     * The track. Changes must be made through track(value), so that the
+     * ray-cast results are recomputed.
+     */
     std::vector<std::vector <char> > & track() { return track_; }
 
-    void track(const std::vector<std::vector <char> > value) { track_ = value; }
+    void track(const std::vector<std::vector <char> > value)
+    {
+        track_ = value;
+        resetRays();
+    }
 
     void mds(const int value) { mds_ = value; }
 
@@ -122,7 +192,11 @@ public:
 
     void starts(const IntPairSet theStarts) { starts_ = theStarts; }
 
-    void useFlatTransition(bool value) { useFlatTransition_ = value; }
+    void useFlatTransition(bool value)
+    {
+        useFlatTransition_ = value;
+        clearSamplers();
+    }
 
     IntPairSet& starts() { return starts_; }
 
@@ -153,6 +227,14 @@ public:
     virtual std::list<mlcore::Successor> transition(mlcore::State* s,
                                                     mlcore::Action* a);
 
+    /**
+     * Overrides method from Problem. Successors of states other than the
+     * initial, goal and absorbing states are cached in the state, and the
+     * view points to the cache.
+     */
+    virtual mlcore::SuccessorView successors(mlcore::State* s,
+                                             mlcore::Action* a);
+
     /**
      * Overrides method from Problem.
      */
@@ -1,6 +1,8 @@
 #ifndef MDPLIB_RACETRACKSTATE_H
 #define MDPLIB_RACETRACKSTATE_H
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 
 #include "../../Problem.h"
@@ -10,13 +12,21 @@
 class RacetrackState : public mlcore::State
 {
 private:
-    int x_;
-    int y_;
-    int vx_;
-    int vy_;
-
-    /* A cache of all successors (for all actions) of this state */
-    std::vector<mlcore::SuccessorsList> allSuccessors_;
+    /*
+     * The position and velocity of the car, as four 16-bit integers packed
+     * in one word (see makeKey()).
+     */
+    uint64_t key_;
+
+    /*
+     * A cache of all successors (for all actions) of this state, stored as
+     * a single run of the successor arena of the problem that starts at
+     * offset successors_ (mdplib::no_index if not computed yet). The
+     * successors of the action with id i are the entries from ends_[i - 1]
+     * (0 for i = 0) to ends_[i] of the run.
+     */
+    std::atomic<uint32_t> successors_;
+    std::atomic<unsigned char> ends_[9];
 
     virtual std::ostream& print(std::ostream& os) const;
 
@@ -25,28 +35,56 @@ public:
      * Creates a state for the racetrack problem with the given (x,y) position
      * and (vx,vy) velocity, and assigned to the given index.
      *
-     * Every tuple (x, y, vx, vy) should be assigned to a unique index.
+     * Every tuple (x, y, vx, vy) should be assigned to a unique index. All
+     * four values must fit in 16-bit signed integers.
      */
     RacetrackState(int x, int y, int vx, int vy, mlcore::Problem* problem);
 
     virtual ~RacetrackState() {}
 
-    int x() const { return x_; }
+    int x() const { return (int16_t) (key_ >> 48); }
 
-    int y() const { return y_; }
+    int y() const { return (int16_t) (key_ >> 32); }
 
-    int vx() const { return vx_; }
+    int vx() const { return (int16_t) (key_ >> 16); }
 
-    int vy() const { return vy_; }
+    int vy() const { return (int16_t) key_; }
 
     /**
-     * Returns a pointer to the successor cache of this state.
+     * Returns true if the successors of the actions are in the successor
+     * cache of this state.
      */
-    std::vector<mlcore::SuccessorsList>* allSuccessors()
+    bool hasSuccessors() const
     {
-        return &allSuccessors_;
+        return successors_.load(std::memory_order_acquire) != mdplib::no_index;
     }
 
+    /**
+     * Returns a view over the cached successors of the action with the
+     * given id.
+     */
+    mlcore::SuccessorView cachedSuccessors(int idAction) const
+    {
+        const mlcore::Successor* run = problem_->successorsAt(
+            successors_.load(std::memory_order_acquire));
+        int begin = idAction == 0 ?
+            0 : ends_[idAction - 1].load(std::memory_order_relaxed);
+        int end = ends_[idAction].load(std::memory_order_relaxed);
+        return mlcore::SuccessorView(run + begin, run + end);
+    }
+
+    /**
+     * Stores the successors of all actions in the cache of this state: the
+     * successors of the action with id i are the entries from ends[i - 1]
+     * (0 for i = 0) to ends[i] of the given view. The successors are copied
+     * to the successor arena of the problem.
+     *
+     * Threads may cache the successors of the same state concurrently, as
+     * long as they compute the same successors.
+     */
+    void cacheSuccessors(const mlcore::SuccessorView& successors,
+                         const unsigned char* ends);
+
     /**
      * Overrides method from State.
      */
@@ -66,6 +104,24 @@ public:
      * Overrides method from State.
      */
     virtual int hashValue() const;
+
+    /**
+     * Overrides method from State.
+     */
+    virtual unsigned packKey(uint64_t* key, unsigned size) const;
+
+    /**
+     * Writes the packed key of the state with the given position and
+     * velocity (see packKey()) and returns its number of words.
+     */
+    static unsigned makeKey(int x, int y, int vx, int vy, uint64_t* key)
+    {
+        key[0] = (uint64_t) (uint16_t) x << 48
+            | (uint64_t) (uint16_t) y << 32
+            | (uint64_t) (uint16_t) vx << 16
+            | (uint16_t) vy;
+        return 1;
+    }
 };
 
 #endif // MDPLIB_RACETRACKSTATE_H
@@ -0,0 +1,38 @@
+#ifndef MDPLIB_SAILDIJKSTRAHEUR_H
+#define MDPLIB_SAILDIJKSTRAHEUR_H
+
+#include <vector>
+
+#include "../../Heuristic.h"
+
+#include "SailingProblem.h"
+
+class SailingProblem;
+
+/**
+ * A heuristic for the sailing domain that assumes the wind can change to
+ * any direction it may change to (the all-outcomes determinization), which
+ * results in an admissible heuristic.
+ *
+ * The costs of all states are computed when the heuristic is constructed,
+ * with a single Dijkstra search from the goal states, and stored in a dense
+ * table indexed by (x, y, wind), so that cost() is a single array lookup.
+ * States from which the goal can't be reached get mdplib::dead_end_cost.
+ */
+class SailingDijkstraHeuristic : public mlcore::Heuristic
+{
+private:
+    int cols_;
+
+    /* The costs of the states, indexed by (x, y, wind). */
+    std::vector<double> costs_;
+
+public:
+    SailingDijkstraHeuristic(SailingProblem* problem);
+
+    virtual ~SailingDijkstraHeuristic() {}
+
+    virtual double cost(const mlcore::State* s);
+};
+
+#endif // MDPLIB_SAILDIJKSTRAHEUR_H
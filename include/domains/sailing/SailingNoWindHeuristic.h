@@ -12,7 +12,6 @@ class SailingNoWindHeuristic : public mlcore::Heuristic
 {
 private:
     SailingProblem* problem_;
-    SailingState* tmp_;
 public:
     SailingNoWindHeuristic();
     virtual ~SailingNoWindHeuristic() {}
@@ -13,11 +13,13 @@
 
 enum tack_t {AWAY = 0, DOWN = 1, CROSS = 2, UP = 3, INTO = 4};
 
+class SailingDijkstraHeuristic;
 class SailingNoWindHeuristic;
 class SailingState;
 
 class SailingProblem : public mlcore::Problem
 {
+friend SailingDijkstraHeuristic;
 friend SailingNoWindHeuristic;
 
 private:
@@ -65,7 +67,17 @@ public:
     virtual std::list<mlcore::Successor>
     transition(mlcore::State* s, mlcore::Action* a);
 
-    void useFlatTransition(bool value) { useFlatTransition_ = value; }
+    /**
+     * Overrides method from Problem.
+     */
+    virtual mlcore::SuccessorView
+    successors(mlcore::State* s, mlcore::Action* a);
+
+    void useFlatTransition(bool value)
+    {
+        useFlatTransition_ = value;
+        clearSamplers();
+    }
 
     /**
      * Overrides method from Problem.
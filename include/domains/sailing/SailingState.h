@@ -83,6 +83,25 @@ public:
     {
         return 31*(x_ + 31*(y_ + 31*wind_));
     }
+
+    /**
+     * Overrides method from State.
+     */
+    virtual unsigned packKey(uint64_t* key, unsigned /* size */) const
+    {
+        key[0] = makeKey(x_, y_, wind_);
+        return 1;
+    }
+
+    /**
+     * Returns the packed key (a single word) of the state with the given
+     * position and wind direction.
+     */
+    static uint64_t makeKey(short x, short y, short wind)
+    {
+        return (uint64_t) (uint16_t) x << 32 |
+               (uint64_t) (uint16_t) y << 16 | (uint16_t) wind;
+    }
 };
 
 #endif // MDPLIB_SAILINGSTATE_H
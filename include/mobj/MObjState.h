@@ -56,22 +56,23 @@ public:
     void resetCost(std::vector<double>& weights, int keepIdx)
     {
         MOProblem* mobjProblem_ = (MOProblem*) problem_;
-        cost_ = 0;
+        double cost = 0;
         gValue_ = 0;
         hValue_ = 0;
         mobjCost_ = std::vector<double> (mobjProblem_->size(), 0.0);
         for (int i = 0; i < mobjProblem_->size(); i++) {
             if (i == keepIdx) {
-                cost_ += mobjCost_[i] * weights[i];
+                cost += mobjCost_[i] * weights[i];
                 continue;
             }
             if (mobjProblem_->heuristics().size() > i &&
                     mobjProblem_->heuristics()[i] != nullptr) {
                 mobjCost_[i] = mobjProblem_->heuristics()[i]->cost(this);
-                cost_ += mobjProblem_->heuristics()[i]->cost(this) * weights[i];
+                cost += mobjProblem_->heuristics()[i]->cost(this) * weights[i];
                 hValue_ += mobjProblem_->heuristics()[i]->cost(this) * weights[i];
             }
         }
+        setCost(cost);
     }
 
     /**
@@ -111,6 +111,14 @@ protected:
      */
     bool useContPlanEvaluationTransition_;
 
+    /**
+     * Returns the state of this model with the given original state and
+     * exception counter, creating and storing it only if it hasn't been
+     * stored before.
+     */
+    mlcore::State* reducedState(mlcore::State* originalState,
+                                int exceptionCount);
+
 public:
     ReducedModel(mlcore::Problem* originalProblem,
                  ReducedTransition* reducedTransition,
@@ -152,6 +160,14 @@ public:
         clean_ = true;
     }
 
+    /**
+     * Destroys all states of this model and restarts it from the initial
+     * state using the given reduced transition. The memory of the states is
+     * reused by the new model (see Problem::clearStates()), which makes it
+     * cheap to evaluate several reductions one after another.
+     */
+    void reset(ReducedTransition* reducedTransition);
+
     /**
      * Sets the maximum number of exceptions before considering only
      * primary outcomes in the transition function.
@@ -86,6 +86,25 @@ public:
         return originalState_->hashValue() + 37 * exceptionCount_;
     }
 
+    virtual unsigned packKey(uint64_t* key, unsigned /* size */) const
+    {
+        return makeKey(originalState_, exceptionCount_, key);
+    }
+
+    /**
+     * Writes the packed key of the reduced state with the given original
+     * state and exception counter (see packKey()) and returns its number
+     * of words. Original states are compared by address, as in operator==.
+     */
+    static unsigned makeKey(mlcore::State* originalState,
+                            int exceptionCount,
+                            uint64_t* key)
+    {
+        key[0] = (uint64_t) (uintptr_t) originalState;
+        key[1] = (uint64_t) (uint32_t) exceptionCount;
+        return 2;
+    }
+
 
     virtual std::ostream& print(std::ostream& os) const
     {
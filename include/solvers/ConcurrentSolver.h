@@ -1,6 +1,7 @@
 #ifndef MDPLIB_CONCURRENTSOLVER_H
 #define MDPLIB_CONCURRENTSOLVER_H
 
+#include <atomic>
 #include <thread>
 #include <mutex>
 
@@ -19,9 +20,13 @@ namespace mlsolvers
  * action for planning.
  * The base solvers supported are LAO* and LRTDP.
  *
- * The class provides a mutex object to ensure that no race conditions arise
- * between the planning and execution threads try to access state variables
- * (e.g., cost,  best actions).
+ * The planning thread holds mlsolvers::bellman_mutex during every call to
+ * the base solver's solve() method, so the execution thread can lock it to
+ * pause planning while it reads or changes the problem (e.g., to expand the
+ * current state or change the successors of a dummy state). The base
+ * solver should be configured so that each call is short (e.g., one trial
+ * of LRTDP or a time limit for LAO*), since the execution thread waits for
+ * the current call to finish.
  */
 class ConcurrentSolver
 {
@@ -30,13 +35,13 @@ private:
 
     mlcore::State* state_ = nullptr;
 
-    std::thread* solverThread;
+    std::thread* solverThread = nullptr;
 
     static void threadEntry(ConcurrentSolver* instance);
 
     void runSolver() const;
 
-    bool keepRunning_ = true;
+    std::atomic<bool> keepRunning_{true};
 
 public:
     /**
@@ -52,13 +57,15 @@ public:
      */
     virtual ~ConcurrentSolver()
     {
-        if (solverThread->joinable())
+        if (solverThread != nullptr && solverThread->joinable())
             solverThread->join();
         delete solverThread;
     }
 
     /**
      * Sets the state the base solver must plan for in the next iteration.
+     * Must be called while holding mlsolvers::bellman_mutex once the solver
+     * is running.
      *
      * @param state the state that the base solver must plan for.
      */
@@ -62,7 +62,7 @@ private:
      * Computes the depth of the given successor state for the given depth of
      * its parent state.
      */
-    double computeNewDepth(mlcore::Successor& su, double depth);
+    double computeNewDepth(const mlcore::Successor& su, double depth);
 
 public:
     /**
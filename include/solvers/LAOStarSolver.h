@@ -19,7 +19,9 @@ class LAOStarSolver : public Solver
 {
 private:
     mlcore::Problem* problem_;
-    mlcore::StateSet visited;
+
+    /* The visit epoch of the current expand/convergence pass */
+    uint32_t visitEpoch_;
 
     /* Error tolerance */
     double epsilon_ = 1.0e-6;
@@ -1,6 +1,11 @@
 #ifndef MDPLIB_LRTDPSOLVER_H
 #define MDPLIB_LRTDPSOLVER_H
 
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <vector>
+
 #include "../Problem.h"
 #include "../Heuristic.h"
 
@@ -18,6 +23,17 @@ class LRTDPSolver : public Solver
 {
 private:
 
+    /*
+     * The state owned by each thread when solving with several threads: a
+     * stamp per dense state index that replaces the mdplib::CLOSED bit
+     * during checkSolved (a state is closed iff closed[index] == stamp).
+     */
+    struct Worker
+    {
+        std::vector<unsigned int> closed;
+        unsigned int stamp = 0;
+    };
+
     mlcore::Problem* problem_;
     int maxTrials_;
     double epsilon_;
@@ -28,11 +44,30 @@ private:
     /* If true the algorithm runs like RTDP (no labeling). */
     bool dont_label_;
 
-    /* Performs a single LRTDP trial */
-    void trial(mlcore::State* s);
+    /* Number of threads running trials. */
+    int numThreads_;
+
+    /* Number of trials started by all threads in the current call to solve. */
+    std::atomic<int> trials_;
+
+    /*
+     * The random number stream used by the first trial of the current call
+     * to solve; trial i uses stream firstStream_ + i (see
+     * mlsolvers::reserveRNGStreams()).
+     */
+    uint64_t firstStream_;
+
+    /*
+     * Performs a single LRTDP trial, sampling successors with rng. If worker
+     * is null the trial uses the mdplib::CLOSED bits.
+     */
+    void trial(mlcore::State* s, mdplib::Rng& rng, Worker* worker = nullptr);
 
     /* Checks if the state has been solved. */
-    bool checkSolved(mlcore::State* s);
+    bool checkSolved(mlcore::State* s, Worker* worker = nullptr);
+
+    /* Runs trials from s0 on the calling thread until s0 is solved. */
+    void runTrials(mlcore::State* s0, Worker* worker);
 
     /* The time at which planning began. */
     std::chrono::time_point<std::chrono::high_resolution_clock> beginTime_;
@@ -68,6 +103,23 @@ public:
      */
     virtual void maxPlanningTime(time_t theTime) { maxTime_ = theTime; }
 
+    /**
+     * Sets the number of threads running trials from s0.
+     *
+     * The threads share the values of the states. Every trial samples
+     * successors from its own random number stream, so a trial draws the
+     * same numbers for any number of threads. Each thread keeps its own
+     * marks of the states visited by checkSolved, and states are labeled as
+     * solved with State::setBitsAtomic(). The maximum number of trials is
+     * shared by all threads.
+     *
+     * While solving, Problem::concurrentStates() is enabled, and the
+     * heuristic must be safe to call from several threads. With more than
+     * one thread the problem must not use a value store, and its states
+     * must have distinct dense indices.
+     */
+    void numThreads(int value) { numThreads_ = std::max(1, value); }
+
 };
 
 }
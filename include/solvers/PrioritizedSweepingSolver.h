@@ -0,0 +1,85 @@
+#ifndef MDPLIB_PRIORITIZEDSWEEPINGSOLVER_H
+#define MDPLIB_PRIORITIZEDSWEEPINGSOLVER_H
+
+#include "../Problem.h"
+#include "../State.h"
+
+#include "Solver.h"
+
+namespace mlsolvers
+{
+
+/**
+ * An asynchronous Value Iteration solver that uses prioritized sweeping.
+ *
+ * The solver keeps an estimate of the Bellman residual of each state, which
+ * is exact after a pass over all states. Backing up a state raises the
+ * estimates of its predecessors only, since those are the only states whose
+ * residual can change, to the largest change that the backup can cause in
+ * their Q-values. States whose estimate reaches the tolerance are kept in a
+ * heap and backed up in rounds, from the goals outwards, so that a round
+ * propagates changes along paths to the goals like a sweep of VI in the
+ * right order would. When the heap is empty, another pass over all states
+ * checks the residuals, and the solver stops once all of them are below the
+ * tolerance, which is the same convergence criterion used by VISolver.
+ *
+ * The predecessors are read from the problem's predecessor index
+ * (see Problem::generateAll()), which is built by the solver if needed.
+ */
+class PrioritizedSweepingSolver : public Solver
+{
+private:
+    /* The problem to solve. */
+    mlcore::Problem* problem_;
+
+    /* Maximum number of backups allowed. */
+    long maxBackups_;
+
+    /* Residual error tolerance. */
+    double tol_;
+
+    /* Maximum time allowed for planning (in milliseconds). */
+    int maxTime_;
+
+    /* Number of backups performed by the last call to solve(). */
+    long backups_;
+
+public:
+    /**
+     * Creates a prioritized sweeping solver for the specified problem.
+     *
+     * @param problem The problem to be solved.
+     * @param maxBackups The maximum number of backups to perform.
+     * @param tol The tolerance for the Bellman residual.
+     */
+    PrioritizedSweepingSolver(mlcore::Problem* problem,
+                              long maxBackups = 1000000000,
+                              double tol = 1.0e-6);
+
+    virtual ~PrioritizedSweepingSolver() { }
+
+    /**
+     * Solves the associated problem for all states reachable from the
+     * initial state of the problem.
+     *
+     * Parameter s0 and return value only kept for compatibility with Solver
+     * abstract class, they are not used by the method and the return value
+     * is always a nullptr.
+     */
+    virtual mlcore::Action* solve(mlcore::State* s0 = nullptr);
+
+    /**
+     * Sets the maximum planning time allowed to the algorithm (milliseconds).
+     */
+    virtual void maxPlanningTime(time_t theTime) { maxTime_ = theTime; }
+
+    /**
+     * Returns the number of backups performed by the last call to solve(),
+     * including those computed by the passes that check the residuals.
+     */
+    long backups() const { return backups_; }
+};
+
+}
+
+#endif // MDPLIB_PRIORITIZEDSWEEPINGSOLVER_H
@@ -6,10 +6,12 @@
 #include <vector>
 #include <mutex>
 
+#include "../CompiledProblem.h"
 #include "../Heuristic.h"
 #include "../Problem.h"
 #include "../State.h"
 #include "../util/general.h"
+#include "../util/rng.h"
 
 #define bb_cost first
 #define bb_action second
@@ -19,8 +21,13 @@
 namespace mlsolvers
 {
 /**
- * A mutex used by BellmanUpdate in order to avoid race conditions while
- * planning/executing concurrently.
+ * A mutex that coordinates planning and execution threads: ConcurrentSolver
+ * holds it while its base solver runs, so other threads can lock it to
+ * pause planning (see test/testConc.cpp).
+ *
+ * It is not taken by bellmanUpdate(): the cost and best action of a state
+ * are atomic (see mlcore::State), so threads can update different states
+ * without a shared lock.
  */
 extern std::mutex bellman_mutex;
 
@@ -30,14 +37,36 @@ extern std::mutex bellman_mutex;
 extern std::random_device rand_dev;
 
 /**
- * Mersenne Twister 19937 generator.
+ * Sets the seed of all random number streams (1234 by default), restarts
+ * the stream numbering, and restarts the generator of the calling thread
+ * at stream 0.
+ *
+ * Runs are reproducible for a given seed as long as the streams are
+ * reserved in the same order (see reserveRNGStreams()).
+ */
+void seedRNG(uint64_t seed);
+
+/**
+ * Returns the seed of the random number streams.
+ */
+uint64_t rngSeed();
+
+/**
+ * Reserves n consecutive stream numbers and returns the first one. Code
+ * running work items in parallel reserves one stream per item (e.g., per
+ * trial), so that each item draws the same numbers regardless of the
+ * number of threads and of which thread runs it.
  */
-extern std::mt19937 kRNG;
+uint64_t reserveRNGStreams(uint64_t n);
 
 /**
- * Uniform distribution [0,1] generator.
+ * Returns the random number generator of the calling thread. Each thread
+ * gets its own stream the first time it calls this function, so the
+ * generator can be used without locking; the numbers drawn by threads
+ * other than the one calling seedRNG() depend on the order in which they
+ * start drawing.
  */
-extern std::uniform_real_distribution<> kUnif_0_1;
+mdplib::Rng& threadRNG();
 
 /**
  * An interface describing planning algorithms.
@@ -124,6 +153,10 @@ bellmanBackup(mlcore::Problem* problem, mlcore::State* s);
  * Performs a Bellman backup of a state, and then updates the state with
  * the resulting expected cost and greedy action.
  *
+ * If the problem is using a value store (see Problem::useValueStore()) the
+ * backup reads and writes the values in the store instead of the
+ * state objects.
+ *
  * @param problem The problem that contains the given state.
  * @param s The state on which the Bellman backup will be performed.
  * @return The residual of the state.
@@ -167,6 +200,17 @@ mlcore::State* randomSuccessor(mlcore::Problem* problem,
                                double* prob = nullptr);
 
 
+/**
+ * Same as randomSuccessor(problem, s, a, prob), but draws the random number
+ * from the given generator instead of threadRNG().
+ */
+mlcore::State* randomSuccessor(mlcore::Problem* problem,
+                               mlcore::State* s,
+                               mlcore::Action* a,
+                               mdplib::Rng& rng,
+                               double* prob = nullptr);
+
+
 /**
  * Returns the action with minimum Q-value for a state.
  *
@@ -304,6 +348,58 @@ bool testDeadEndRecursion(mlcore::Problem* problem,
  */
 bool testDeadEnds(mlcore::Problem* problem);
 
+/**
+ * Tests if the given compiled problem has dead-ends, with the same semantics
+ * as testDeadEnds(mlcore::Problem*): the model has no dead-ends if a goal is
+ * reachable from the initial state and every state visited by the search can
+ * reach a goal. Since goals are considered connected to every state, all
+ * states are visited once a goal is reached.
+ */
+bool testDeadEnds(const mlcore::CompiledProblem& model);
+
+/**
+ * Computes the strongly connected components of the graph of a compiled
+ * problem, using an iterative version of Tarjan's algorithm (the same
+ * algorithm used by [testDeadEndRecursion], without the recursion). Goal
+ * states are treated as having no successors.
+ *
+ * Components are numbered in the order Tarjan's algorithm finishes them,
+ * which is a reverse topological order: all successors of the states in
+ * component i are in components 0, ..., i.
+ *
+ * @param model The compiled problem.
+ * @param root The state where the search starts; only the states reachable
+ *             from it are assigned a component. If root is mdplib::no_index
+ *             the search is repeated until all states are assigned.
+ * @param component Stores the component of each state (mdplib::no_index for
+ *                  states that were not reached).
+ * @return The number of components found.
+ */
+uint32_t stronglyConnectedComponents(const mlcore::CompiledProblem& model,
+                                     uint32_t root,
+                                     std::vector<uint32_t>& component);
+
+/**
+ * Evaluates a policy on a compiled problem, using iterative policy
+ * evaluation.
+ *
+ * @param model The compiled problem.
+ * @param policy The state-action pair chosen for each state
+ *               (mdplib::no_index for none, in which case the state keeps its
+ *               value). See mlcore::CompiledProblem::currentPolicy().
+ * @param values The initial values of the states, which are replaced by the
+ *               value of the policy. Values are capped at
+ *               mdplib::dead_end_cost.
+ * @param tol The tolerance for the residual.
+ * @param maxIter The maximum number of iterations.
+ * @return The residual of the last iteration.
+ */
+double evaluatePolicy(const mlcore::CompiledProblem& model,
+                      const std::vector<uint32_t>& policy,
+                      std::vector<double>& values,
+                      double tol = 1.0e-6,
+                      int maxIter = 1000000);
+
 } // mlsolvers
 
 
@@ -0,0 +1,105 @@
+#ifndef MDPLIB_TOPOLOGICALVISOLVER_H
+#define MDPLIB_TOPOLOGICALVISOLVER_H
+
+#include <algorithm>
+#include <vector>
+
+#include "../CompiledProblem.h"
+#include "../Problem.h"
+#include "../State.h"
+
+#include "Solver.h"
+
+namespace mlsolvers
+{
+
+/**
+ * A MDP solver that uses Topological Value Iteration, as described in
+ * http://www.aaai.org/Papers/IJCAI/2007/IJCAI07-296.pdf
+ *
+ * The graph of the problem is decomposed into strongly connected components,
+ * which are solved one at a time in reverse topological order, each until
+ * its residual is below the tolerance. When a component is solved, the
+ * values of all its successors are already final, so no state is backed up
+ * again after its component converges.
+ *
+ * Components that do not depend on each other (those at the same level of
+ * the condensation graph) can be solved in parallel.
+ */
+class TopologicalVISolver : public Solver
+{
+private:
+    /* The problem to solve. */
+    mlcore::Problem* problem_;
+
+    /* If not null, a compiled snapshot of the problem to run on. */
+    mlcore::CompiledProblem* compiled_;
+
+    /* Maximum number of sweeps allowed for each component. */
+    int maxIter_;
+
+    /* Residual error tolerance. */
+    double tol_;
+
+    /* Maximum time allowed for planning (in milliseconds). */
+    int maxTime_;
+
+    /* Number of threads used to solve the components of a level. */
+    int numThreads_;
+
+    /* Solves the given compiled problem, starting at state s0. */
+    void solveCompiled(mlcore::CompiledProblem* model, mlcore::State* s0);
+
+public:
+    /**
+     * Creates a Topological Value Iteration solver for the specified problem.
+     * The states of the problem must have been generated
+     * (e.g., with Problem::generateAll()).
+     *
+     * @param problem The problem to be solved.
+     * @param maxIter The maximum number of sweeps to perform on each
+     *                strongly connected component.
+     * @param tol The tolerance for the Bellman residual.
+     */
+    TopologicalVISolver(mlcore::Problem* problem,
+                        int maxIter = 100000,
+                        double tol = 1.0e-6);
+
+    /**
+     * Creates a Topological Value Iteration solver that runs directly on the
+     * given compiled snapshot of a problem.
+     *
+     * @param compiled The compiled problem to be solved.
+     * @param maxIter The maximum number of sweeps to perform on each
+     *                strongly connected component.
+     * @param tol The tolerance for the Bellman residual.
+     */
+    TopologicalVISolver(mlcore::CompiledProblem* compiled,
+                        int maxIter = 100000,
+                        double tol = 1.0e-6);
+
+    virtual ~TopologicalVISolver() { }
+
+    /**
+     * Solves the associated problem using Topological Value Iteration.
+     *
+     * If s0 is not a nullptr, only the states reachable from s0 are solved;
+     * otherwise all states of the problem are solved. The return value is
+     * always a nullptr.
+     */
+    virtual mlcore::Action* solve(mlcore::State* s0 = nullptr);
+
+    /**
+     * Sets the maximum planning time allowed to the algorithm (milliseconds).
+     */
+    virtual void maxPlanningTime(time_t theTime) { maxTime_ = theTime; }
+
+    /**
+     * Sets the number of threads used to solve independent components.
+     */
+    void numThreads(int value) { numThreads_ = std::max(1, value); }
+};
+
+}
+
+#endif // MDPLIB_TOPOLOGICALVISOLVER_H
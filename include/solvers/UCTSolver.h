@@ -1,19 +1,54 @@
 #ifndef MDPLIB_UCTSOLVER_H
 #define MDPLIB_UCTSOLVER_H
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "../Action.h"
 #include "../Problem.h"
 #include "../State.h"
 
+#include "../util/arena.h"
+
 #include "Solver.h"
 
 namespace mlsolvers
 {
 
+/* Parallel modes of UCTSolver. */
+const int uct_sequential = 0;
+const int uct_root_parallel = 1;
+const int uct_tree_parallel = 2;
+
+// The statistics of an action applicable in a node of the UCT DAG.
+struct UCTActionStats {
+    // The action.
+    mlcore::Action* action_;
+
+    // The number of times the action was chosen in the node (starting at
+    // the number of "virtual rollouts").
+    std::atomic<int> count_;
+
+    // The estimated Q-value of the action in the node.
+    std::atomic<double> qvalue_;
+
+    // The number of rollouts currently going through the action
+    // (only used with tree parallelism).
+    std::atomic<int> pending_;
+};
+
 // A node of the UCT DAG, representing a state at a given depth.
+//
+// The statistics of the applicable actions of a node are stored in
+// numActions_ consecutive entries starting at actions_.
 class UCTNode {
 public:
     // The state this node represents.
@@ -22,76 +57,121 @@ public:
     // The depth of the state in the UCT tree.
     int depth_;
 
-    // Creates a node for the given state at the given depth.
-    UCTNode(mlcore::State* state, int depth) :
-        state_(state), depth_(depth) { }
+    // The number of times the node was visited.
+    std::atomic<int> count_;
+
+    // The statistics of the applicable actions.
+    UCTActionStats* actions_;
 
-    // Destructor. Nothing to do here.
-    ~UCTNode() {}
+    // The number of applicable actions.
+    uint32_t numActions_;
 
     friend std::ostream& operator<<(std::ostream& os, UCTNode* node) {
         os << "(" << node->state_ << ", " << node->depth_ << ")";
         return os;
     }
-
-    bool operator==(const UCTNode& rhs) const {
-        return state_ == rhs.state_ && depth_ == rhs.depth_;
-    }
-
-    // Equality function used for unordered sets/maps.
-    bool equals(UCTNode *other) const {
-        return *this == *other;
-    }
-
-    // State hash function used for unordered sets/maps.
-    int hashValue() const {
-        return state_->hashValue() + 31 * depth_;
-    }
 };
 
-//Wrapper of the hash function for nodes (used to define the maps below).
-struct UCTNodeHash {
-  size_t operator()(UCTNode* node) const {
-    return node->hashValue();
-  }
-};
+// The (state, depth) pair identifying a node.
+typedef std::pair<mlcore::State*, int> UCTNodeKey;
 
-//Wrapper of the equality operator for nodes (used to define the maps below).
-struct UCTNodeEqual {
-  bool operator() (UCTNode* node1, UCTNode* node2) const {
-    return node1->equals(node2);
+// Hash function for node keys (states are the ones stored by the problem,
+// so they can be compared by address).
+struct UCTNodeKeyHash {
+  size_t operator()(const UCTNodeKey& key) const {
+    return std::hash<mlcore::State*>()(key.first) + 31 * key.second;
   }
 };
 
-// A map from nodes to to integers.
-typedef std::unordered_map<UCTNode*,
-                           int,
-                           UCTNodeHash,
-                           UCTNodeEqual> UCTNodeIntMap;
+// A map from node keys to nodes.
+typedef std::unordered_map<UCTNodeKey, UCTNode*, UCTNodeKeyHash> UCTNodeIndex;
+
+// A UCT DAG. Nodes and action statistics are allocated from arenas, so
+// they never move while the DAG grows.
+struct UCTTree {
+    // The nodes visited by the algorithm.
+    BlockArena<UCTNode> nodes_;
+
+    // The statistics of the applicable actions of all nodes.
+    BlockArena<UCTActionStats> actions_;
 
-// A map from nodes to a map from action to integers.
-typedef std::unordered_map<UCTNode*,
-                           mlcore::ActionIntMap,
-                           UCTNodeHash,
-                           UCTNodeEqual> UCTNodeActionIntMap;
+    // The visited nodes, by state and depth.
+    UCTNodeIndex index_;
 
-// A map from nodes to a map from action to doubles.
-typedef std::unordered_map<UCTNode*,
-                           mlcore::ActionDoubleMap,
-                           UCTNodeHash,
-                           UCTNodeEqual> UCTNodeActionDoubleMap;
+    // Protects index_ and the arenas when several threads share the DAG.
+    std::mutex mutex_;
 
-// A set of nodes.
-typedef std::unordered_set<UCTNode*, UCTNodeHash, UCTNodeEqual> UCTNodeSet;
+    // The number of nodes left by the last call to UCTSolver::pruneTree().
+    size_t keptSize_ = 0;
+
+    // Exchanges the nodes of this DAG with those of the given DAG.
+    void swap(UCTTree& other) {
+        nodes_.swap(other.nodes_);
+        actions_.swap(other.actions_);
+        index_.swap(other.index_);
+        std::swap(keptSize_, other.keptSize_);
+    }
+
+    // Removes all nodes. If release is true the memory used by the nodes is
+    // also returned to the allocator.
+    void clear(bool release) {
+        if (release) {
+            nodes_.release();
+            actions_.release();
+            UCTNodeIndex().swap(index_);
+            keptSize_ = 0;
+        } else {
+            nodes_.clear();
+            actions_.clear();
+            index_.clear();
+            keptSize_ = 0;
+        }
+    }
+};
 
 /**
  * An SSP solver using the UCT algorithm.
  *
  * See http://link.springer.com/chapter/10.1007/11871842_29
+ *
+ * The rollouts can be run by several threads (see the constructor). With
+ * root parallelism (uct_root_parallel) each thread builds its own DAG and
+ * the statistics of the root actions are merged when the rollouts are done.
+ * With tree parallelism (uct_tree_parallel) the threads share one DAG,
+ * update its counters atomically, and add a virtual loss to the actions
+ * that other threads are exploring (see virtualLoss()).
+ *
+ * While the threads run, Problem::concurrentStates() is enabled, and the
+ * heuristic must be safe to call from several threads.
  */
 class UCTSolver : public Solver {
 
 private:
+
+    // The state owned by each thread running rollouts.
+    struct Worker {
+        // The DAG the thread works on.
+        UCTTree* tree_;
+
+        // The random number generator of the current rollout. Rollout r of
+        // the worker draws from stream first_stream_ + r (see
+        // mlsolvers::reserveRNGStreams()).
+        mdplib::Rng rng_;
+        uint64_t first_stream_;
+
+        // Per-step buffers reused by all rollouts: the node visited, the
+        // action chosen and the accumulated cost at each step.
+        std::vector<UCTNode*> nodes_;
+        std::vector<UCTActionStats*> actions_;
+        std::vector<double> costs_;
+
+        // Buffer used by pickAction for the unexplored actions.
+        std::vector<UCTActionStats*> unexplored_;
+
+        // Buffer used by getNode for the Q-values of a new node.
+        std::vector<double> qvalues_;
+    };
+
     mlcore::Problem* problem_;
 
     // Exploration constant.
@@ -107,7 +187,8 @@ private:
     int start_depth_ ;
 
     // If true, the start depth of the search and the cutoff are increased
-    // by one after each call to |solve|.
+    // by one after each call to |solve|, and the part of the DAG below the
+    // state given to the next call is kept.
     bool auto_adjust_depth_;
 
     // If true, C will always be set relative to the current Q(s,a,d).
@@ -119,20 +200,54 @@ private:
     // as used in PROST.
     int delta_;
 
-    // Stores the nodes visited by the algorithm.
-    UCTNodeSet visited_;
+    // How the rollouts are split among threads (uct_sequential,
+    // uct_root_parallel or uct_tree_parallel).
+    int parallel_mode_;
+
+    // The number of threads running rollouts.
+    int num_threads_;
+
+    // The cost added to the Q-value of an action for each rollout that is
+    // currently going through it (tree parallelism).
+    double virtual_loss_;
 
-    // The counters for the nodes (number of times visited).
-    UCTNodeIntMap counters_node_;
+    // If true, solve() returns the explored root action with the lowest
+    // Q-value instead of the greedy action.
+    bool root_policy_;
 
-    // The counters for the node-action pairs.
-    UCTNodeActionIntMap counters_node_action_;
+    // The DAG built by the algorithm (shared by all threads with tree
+    // parallelism, and the DAG of thread 0 with root parallelism).
+    UCTTree tree_;
+
+    // The DAGs of threads 1, ..., num_threads_ - 1 with root parallelism.
+    std::vector<std::unique_ptr<UCTTree>> worker_trees_;
+
+    // Returns true if several threads update tree_ at the same time.
+    bool sharedTree() const {
+        return parallel_mode_ == uct_tree_parallel && num_threads_ > 1;
+    }
 
-    // The estimated Q-values of the actions.
-    UCTNodeActionDoubleMap action_qvalues_;
+    // Returns the node of the worker's DAG for the given state and depth,
+    // creating and initializing the node if it hasn't been visited.
+    UCTNode* getNode(Worker& worker, mlcore::State* s, int depth);
 
-    // Returns an action using the given exploration constant.
-    mlcore::Action* pickAction(UCTNode* node, double C);
+    // Returns the statistics of an action using the given exploration
+    // constant, or nullptr if no action is applicable.
+    UCTActionStats* pickAction(Worker& worker, UCTNode* node, double C);
+
+    // Performs max_rollouts rollouts from s0 on the worker's DAG.
+    void rollouts(Worker& worker, mlcore::State* s0, int max_rollouts);
+
+    // Adds the statistics of the root actions of the given DAGs to those of
+    // the root of tree_.
+    void mergeRoots(mlcore::State* s0);
+
+    // Removes from the given DAG all nodes that can't be reached from the
+    // node for s0 at start_depth_ (the whole DAG if there is no such node),
+    // and releases the memory they used. Since the cost of a pass grows
+    // with the number of nodes kept, a pass is only made once the DAG has
+    // doubled in size since the previous one.
+    void pruneTree(UCTTree& tree, mlcore::State* s0);
 
 public:
     UCTSolver();
@@ -151,6 +266,10 @@ public:
      * @param use_qvalues_for_c If true, the given C will be ignored and the
      *        Q-values will be used for the exploration parameter.
      * @param delta Number of "virtual rollouts" per action for initialization.
+     * @param parallel_mode How the rollouts are split among threads
+     *        (uct_sequential, uct_root_parallel or uct_tree_parallel).
+     * @param num_threads The number of threads for the parallel modes. The
+     *        maximum number of rollouts is shared by all threads.
      */
     UCTSolver(mlcore::Problem* problem,
               int max_rollouts,
@@ -158,24 +277,56 @@ public:
               double C = 0.0,
               bool use_qvalues_for_c = true,
               int delta = 0,
-              bool auto_adjust_depth = false) :
+              bool auto_adjust_depth = false,
+              int parallel_mode = uct_sequential,
+              int num_threads = 1) :
         problem_(problem), max_rollouts_(max_rollouts),
         cutoff_(cutoff), C_(C), use_qvalues_for_c_(use_qvalues_for_c),
-        delta_(delta), auto_adjust_depth_(auto_adjust_depth), start_depth_(0)
+        delta_(delta), auto_adjust_depth_(auto_adjust_depth), start_depth_(0),
+        parallel_mode_(parallel_mode),
+        num_threads_(parallel_mode == uct_sequential ?
+                     1 : std::max(1, num_threads)),
+        virtual_loss_(1.0), root_policy_(false)
     { }
 
     /**
-     * Returns the Q-values estimated by the UCT algorithm.
+     * Returns the node for the given state and depth, or nullptr if the node
+     * hasn't been visited. With root parallelism only the DAG of the first
+     * thread is searched, whose root holds the merged statistics. The
+     * pointer is valid until the next call to solve() or reset().
      */
-    UCTNodeActionDoubleMap& action_qvalues() { return action_qvalues_; }
+    const UCTNode* node(mlcore::State* s, int depth) const {
+        auto it = tree_.index_.find(UCTNodeKey(s, depth));
+        if (it == tree_.index_.end())
+            return nullptr;
+        return it->second;
+    }
 
     /**
-     * Returns the counter for state-action pair visits.
+     * Returns the statistics of the applicable actions of the given node
+     * (node->numActions_ consecutive entries).
      */
-    UCTNodeActionIntMap& counters_node_action() {
-        return counters_node_action_;
+    const UCTActionStats* actionStats(const UCTNode* node) const {
+        return node->actions_;
     }
 
+    /**
+     * Sets the virtual loss used with tree parallelism: the cost added to
+     * the Q-value of an action, during action selection, for each rollout
+     * that is currently going through the action. It makes threads spread
+     * over different actions instead of following the same path.
+     */
+    void virtualLoss(double value) { virtual_loss_ = value; }
+
+    /**
+     * Sets whether solve() returns the action with the lowest estimated
+     * Q-value among the actions explored at s0, instead of the greedy
+     * action with respect to the current state costs (the default). The
+     * greedy action ignores the statistics of the rollouts, which matters
+     * when the heuristic is poor.
+     */
+    void rootPolicy(bool value) { root_policy_ = value; }
+
     /**
      * Sets the maximum number of sample trajectories to gather.
      *
@@ -198,12 +349,11 @@ public:
 
     /**
      * Resets counters and resets the cutoff and start depth to original value.
+     * The memory used by the UCT DAG is released.
      */
     virtual void reset() {
-        counters_node_.clear();
-        counters_node_action_.clear();
-        action_qvalues_.clear();
-        visited_.clear();
+        tree_.clear(true);
+        worker_trees_.clear();
         cutoff_ -= start_depth_;
         start_depth_ = 0;
     }
@@ -212,19 +362,31 @@ public:
      * Computes the UCB1 cost of the given node and action.
      *
      * @param node The node for which the cost is going to be computed.
-     * @param a The action for which the cost is going to be computed.
+     * @param stats The statistics of the action for which the cost is going
+     *        to be computed.
      * @param C The value of the exploration parameter to be used.
      *
      * @return The cost of the node-action according to the UCB1 formula.
      */
-    double ucb1Cost(UCTNode* node, mlcore::Action* a, double C);
+    double ucb1Cost(const UCTNode& node,
+                    const UCTActionStats& stats,
+                    double C) const;
 
     /**
      * Picks an action for the given state using the UCT algorithm.
      *
+     * If the solver was created with auto_adjust_depth, the DAG built by
+     * the previous calls is reused: s0 is expected to be the state reached
+     * after executing the action returned by the previous call, and its node
+     * at the new start depth becomes the root. Only the nodes reachable from
+     * it are kept (so their statistics are not lost), and the memory of all
+     * other nodes is released. To keep the cost of reuse proportional to the
+     * number of rollouts, unreachable nodes are released in batches, once
+     * the DAG has doubled in size since it was last pruned.
+     *
      * @param s0 The state for which the action will be chosen.
      *
-     * @return The action chosen by UCT.
+     * @return The action chosen by UCT (see rootPolicy()).
      */
 
     virtual mlcore::Action* solve(mlcore::State* s0);
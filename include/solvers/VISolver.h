@@ -1,6 +1,9 @@
 #ifndef MDPLIB_VISOLVER_H
 #define MDPLIB_VISOLVER_H
 
+#include <algorithm>
+
+#include "../CompiledProblem.h"
 #include "../Problem.h"
 #include "../State.h"
 
@@ -8,6 +11,11 @@
 
 namespace mlsolvers
 {
+
+/* Update modes for the parallel sweeps of VISolver. */
+const int vi_gauss_seidel = 0;
+const int vi_jacobi = 1;
+
 /**
  * A MDP solver that using Value Iteration.
  */
@@ -17,6 +25,9 @@ private:
     /* The problem to solve. */
     mlcore::Problem* problem_;
 
+    /* If not null, a compiled snapshot of the problem to run on. */
+    mlcore::CompiledProblem* compiled_;
+
     /* Maximum number of iterations allowed for planning. */
     int maxIter_;
 
@@ -26,6 +37,31 @@ private:
     /* Maximum time allowed for planning (in milliseconds). */
     int maxTime_;
 
+    /* Number of threads used for the sweeps. */
+    int numThreads_;
+
+    /* How values are updated during a sweep (vi_gauss_seidel or vi_jacobi). */
+    int updateMode_;
+
+    /* Number of consecutive states assigned to a thread at a time. */
+    static const uint32_t chunkSize = 1024;
+
+    /* Runs Value Iteration on the given compiled problem. */
+    void solveCompiled(mlcore::CompiledProblem* model);
+
+    /*
+     * Runs the sweeps of solveCompiled() with the given number of threads,
+     * reading values from current and writing them into target (the same
+     * vector for Gauss-Seidel updates). Returns the values of the last
+     * completed sweep.
+     */
+    template<typename Values>
+    Values* sweep(mlcore::CompiledProblem* model,
+                  Values* current,
+                  Values* target,
+                  std::vector<uint32_t>& policy,
+                  int numThreads);
+
 public:
     /**
      * Creates a Value Iteration solver for the specified problem.
@@ -40,6 +76,20 @@ public:
              int maxIter = 100000,
              double tol = 1.0e-6);
 
+    /**
+     * Creates a Value Iteration solver that runs directly on the given
+     * compiled snapshot of a problem, without calling the problem's
+     * transition function. The resulting values and greedy actions are
+     * written back into the states when solve() returns.
+     *
+     * @param compiled The compiled problem to be solved.
+     * @param maxIter The maximum number of iterations to perform.
+     * @param tol The tolerance for the Bellman residual.
+     */
+    VISolver(mlcore::CompiledProblem* compiled,
+             int maxIter = 100000,
+             double tol = 1.0e-6);
+
     /**
      * Solves the associated problem using Value Iteration.
      *
@@ -47,9 +97,40 @@ public:
      * abstract class, they are not used by the method and the return value
      * is always a nullptr.
      *
+     * If the problem is using a value store (see Problem::useValueStore())
+     * the sweeps operate on the store, and its values are written back into
+     * the states before returning.
+     *
+     * If more than one thread or the Jacobi update mode is requested, the
+     * problem is compiled first (see CompiledProblem) and the sweeps run on
+     * the compiled snapshot.
      */
     virtual mlcore::Action* solve(mlcore::State* s0 = nullptr);
 
+    /**
+     * Sets the number of threads used for the sweeps.
+     *
+     * The states are split into chunks of consecutive states that the
+     * threads claim one at a time. The time limit is checked after each
+     * chunk, and the residual of a sweep is the maximum of the residuals
+     * found by each thread.
+     */
+    void numThreads(int value) { numThreads_ = std::max(1, value); }
+
+    /**
+     * Sets how values are updated during a sweep.
+     *
+     * With vi_gauss_seidel (the default) values are updated in place, so
+     * later updates in a sweep see earlier ones; when several threads are
+     * used, the values are shared as atomics and the order in which a thread
+     * sees the updates of the others is not fixed (asynchronous value
+     * iteration), which still converges.
+     * With vi_jacobi each sweep reads the values of the previous sweep and
+     * writes into a second buffer, so the result does not depend on the
+     * number of threads.
+     */
+    void updateMode(int value) { updateMode_ = value; }
+
 
     /**
      * Sets the maximum planning time allowed to the algorithm (milliseconds).
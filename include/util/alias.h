@@ -0,0 +1,83 @@
+#ifndef MDPLIB_ALIAS_H
+#define MDPLIB_ALIAS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace mdplib
+{
+
+/**
+ * An entry of a Walker alias table (see buildAliasTable()).
+ */
+struct AliasEntry {
+    /* The probability of keeping the entry's own outcome. */
+    double threshold;
+
+    /* The outcome returned otherwise. */
+    uint32_t alias;
+};
+
+/**
+ * Builds an alias table for the outcomes 0, ..., n - 1 with the given
+ * weights (which don't need to add up to 1), using Vose's method. With
+ * the table, an outcome is sampled in constant time (see sampleAlias()).
+ *
+ * @param weights The non-negative weights of the outcomes.
+ * @param n The number of outcomes (at least 1).
+ * @param table The n entries of the table.
+ */
+inline void buildAliasTable(const double* weights, size_t n, AliasEntry* table)
+{
+    double total = 0.0;
+    for (size_t i = 0; i < n; i++)
+        total += weights[i];
+    std::vector<double> scaled(n);
+    std::vector<uint32_t> small, large;
+    for (size_t i = 0; i < n; i++) {
+        scaled[i] = total > 0.0 ? weights[i] * n / total : 1.0;
+        if (scaled[i] < 1.0)
+            small.push_back(i);
+        else
+            large.push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+        uint32_t s = small.back(), l = large.back();
+        small.pop_back();
+        table[s].threshold = scaled[s];
+        table[s].alias = l;
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // The outcomes left have (up to rounding errors) a scaled weight of 1.
+    for (uint32_t i : large) {
+        table[i].threshold = 1.0;
+        table[i].alias = i;
+    }
+    for (uint32_t i : small) {
+        table[i].threshold = 1.0;
+        table[i].alias = i;
+    }
+}
+
+/**
+ * Samples an outcome from an alias table with n entries, given a number
+ * drawn uniformly from [0, 1).
+ */
+inline size_t sampleAlias(const AliasEntry* table, size_t n, double u)
+{
+    double x = u * n;
+    size_t i = static_cast<size_t>(x);
+    if (i >= n)
+        i = n - 1;
+    return (x - i) < table[i].threshold ? i : table[i].alias;
+}
+
+}
+
+#endif // MDPLIB_ALIAS_H
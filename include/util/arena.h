@@ -0,0 +1,309 @@
+#ifndef MDPLIB_ARENA_H
+#define MDPLIB_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+
+/**
+ * Allocates runs of consecutive objects of type T from blocks of BlockSize
+ * objects. Objects are never moved, so pointers returned by allocate()
+ * remain valid until clear() or release() is called, even while more
+ * objects are allocated.
+ *
+ * The objects are default-constructed when their block is created and are
+ * handed out again without being reconstructed after clear(), so callers
+ * must initialize every object they allocate.
+ *
+ * The arena itself is not thread-safe.
+ */
+template<typename T, size_t BlockSize = 4096>
+class BlockArena
+{
+private:
+    /* The blocks of BlockSize objects, in allocation order. */
+    std::vector<T*> blocks_;
+
+    /* Blocks for runs longer than BlockSize, one run per block. */
+    std::vector<T*> largeBlocks_;
+
+    /* The block objects are currently allocated from. */
+    size_t current_;
+
+    /* The number of objects used in the current block. */
+    size_t used_;
+
+public:
+    BlockArena() : current_(0), used_(0) { }
+
+    BlockArena(const BlockArena&) = delete;
+
+    BlockArena& operator=(const BlockArena&) = delete;
+
+    ~BlockArena() { release(); }
+
+    /**
+     * Returns a pointer to n consecutive objects.
+     */
+    T* allocate(size_t n)
+    {
+        if (n > BlockSize) {
+            largeBlocks_.push_back(new T[n]);
+            return largeBlocks_.back();
+        }
+        if (blocks_.empty()) {
+            blocks_.push_back(new T[BlockSize]);
+        } else if (used_ + n > BlockSize) {
+            current_++;
+            used_ = 0;
+            if (current_ == blocks_.size())
+                blocks_.push_back(new T[BlockSize]);
+        }
+        T* run = blocks_[current_] + used_;
+        used_ += n;
+        return run;
+    }
+
+    /**
+     * Makes all objects available for allocation again, keeping the blocks.
+     */
+    void clear()
+    {
+        for (T* block : largeBlocks_)
+            delete[] block;
+        largeBlocks_.clear();
+        current_ = 0;
+        used_ = 0;
+    }
+
+    /**
+     * Returns the number of objects held by the arena.
+     */
+    size_t capacity() const
+    {
+        return blocks_.size() * BlockSize;
+    }
+
+    /**
+     * Exchanges the objects of this arena with those of the given arena.
+     */
+    void swap(BlockArena& other)
+    {
+        blocks_.swap(other.blocks_);
+        largeBlocks_.swap(other.largeBlocks_);
+        std::swap(current_, other.current_);
+        std::swap(used_, other.used_);
+    }
+
+    /**
+     * Frees all blocks.
+     */
+    void release()
+    {
+        clear();
+        for (T* block : blocks_)
+            delete[] block;
+        std::vector<T*>().swap(blocks_);
+    }
+};
+
+/**
+ * Allocates runs of consecutive objects of type T, like BlockArena, but
+ * identifies each run by a 32-bit offset instead of a pointer, so that
+ * objects referring to many runs (e.g., the rows of a CSR structure) can
+ * store 4 bytes per run.
+ *
+ * Runs are at most BlockSize objects long, and the arena holds at most
+ * MaxBlocks blocks (by default, enough to use every 32-bit offset); the
+ * program is aborted if either limit is exceeded. The directory of blocks
+ * has a fixed size, so at() can be called while another thread allocates,
+ * as long as the run it reads was allocated before (allocations themselves
+ * must be serialized).
+ */
+template<typename T, size_t BlockSize = (1 << 14), size_t MaxBlocks = (1 << 18)>
+class OffsetArena
+{
+    static_assert(BlockSize * MaxBlocks <= (size_t(1) << 32),
+                  "Offsets must fit in 32 bits");
+
+private:
+    /* The blocks, allocated when first needed. */
+    std::unique_ptr<T*[]> blocks_;
+
+    /* The number of blocks allocated. */
+    size_t numBlocks_;
+
+    /* The offset of the next object to allocate. */
+    size_t next_;
+
+public:
+    /**
+     * Returns the length of the longest run that can be allocated.
+     */
+    static size_t maxRun() { return BlockSize; }
+
+    OffsetArena() : numBlocks_(0), next_(0) { }
+
+    OffsetArena(const OffsetArena&) = delete;
+
+    OffsetArena& operator=(const OffsetArena&) = delete;
+
+    ~OffsetArena() { release(); }
+
+    /**
+     * Returns the offset of n consecutive objects (n <= BlockSize).
+     */
+    uint32_t allocate(size_t n)
+    {
+        if (n > BlockSize) {
+            std::cerr << "OffsetArena: run of " << n << " objects is longer "
+                      << "than the maximum of " << BlockSize << std::endl;
+            abort();
+        }
+        if (next_ % BlockSize + n > BlockSize)
+            next_ += BlockSize - next_ % BlockSize;
+        size_t block = next_ / BlockSize;
+        if (block >= MaxBlocks) {
+            std::cerr << "OffsetArena: out of offsets ("
+                      << BlockSize * MaxBlocks << " objects)" << std::endl;
+            abort();
+        }
+        if (!blocks_) {
+            blocks_.reset(new T*[MaxBlocks]);
+            std::fill(blocks_.get(), blocks_.get() + MaxBlocks, nullptr);
+        }
+        if (block == numBlocks_)
+            blocks_[numBlocks_++] = new T[BlockSize];
+        uint32_t offset = next_;
+        next_ += n;
+        return offset;
+    }
+
+    /**
+     * Returns a pointer to the objects of the run with the given offset.
+     */
+    T* at(uint32_t offset) const
+    {
+        return blocks_[offset / BlockSize] + offset % BlockSize;
+    }
+
+    /**
+     * Makes all objects available for allocation again, keeping the blocks.
+     */
+    void clear() { next_ = 0; }
+
+    /**
+     * Returns the number of objects held by the arena.
+     */
+    size_t capacity() const { return numBlocks_ * BlockSize; }
+
+    /**
+     * Frees all blocks.
+     */
+    void release()
+    {
+        for (size_t i = 0; i < numBlocks_; i++)
+            delete[] blocks_[i];
+        blocks_.reset();
+        numBlocks_ = 0;
+        next_ = 0;
+    }
+};
+
+/**
+ * Allocates raw memory for objects of any type from slabs of SlabSize
+ * bytes. Memory is returned to the allocator in bulk: clear() makes all
+ * slabs available again (to reuse them, e.g., between episodes), and
+ * release() frees them. Objects created in the arena are never destroyed
+ * by it, so owners must call their destructors first if needed.
+ *
+ * The arena itself is not thread-safe.
+ */
+template<size_t SlabSize = (1 << 20)>
+class SlabArena
+{
+private:
+    /* The slabs of SlabSize bytes, in allocation order. */
+    std::vector<char*> slabs_;
+
+    /* Slabs for allocations larger than SlabSize, one per slab. */
+    std::vector<char*> largeSlabs_;
+
+    /* The slab memory is currently allocated from. */
+    size_t current_;
+
+    /* The number of bytes used in the current slab. */
+    size_t used_;
+
+public:
+    SlabArena() : current_(0), used_(0) { }
+
+    SlabArena(const SlabArena&) = delete;
+
+    SlabArena& operator=(const SlabArena&) = delete;
+
+    ~SlabArena() { release(); }
+
+    /**
+     * Returns a pointer to size bytes aligned to the given alignment (which
+     * must be a power of two not larger than alignof(std::max_align_t)).
+     */
+    void* allocate(size_t size, size_t alignment)
+    {
+        if (size > SlabSize) {
+            largeSlabs_.push_back(new char[size]);
+            return largeSlabs_.back();
+        }
+        size_t offset = (used_ + alignment - 1) & ~(alignment - 1);
+        if (slabs_.empty()) {
+            slabs_.push_back(new char[SlabSize]);
+            offset = 0;
+        } else if (offset + size > SlabSize) {
+            current_++;
+            offset = 0;
+            if (current_ == slabs_.size())
+                slabs_.push_back(new char[SlabSize]);
+        }
+        used_ = offset + size;
+        return slabs_[current_] + offset;
+    }
+
+    /**
+     * Makes all memory available for allocation again, keeping the slabs.
+     */
+    void clear()
+    {
+        for (char* slab : largeSlabs_)
+            delete[] slab;
+        largeSlabs_.clear();
+        current_ = 0;
+        used_ = 0;
+    }
+
+    /**
+     * Frees all slabs.
+     */
+    void release()
+    {
+        clear();
+        for (char* slab : slabs_)
+            delete[] slab;
+        std::vector<char*>().swap(slabs_);
+    }
+
+    /**
+     * Returns the number of bytes held by the arena.
+     */
+    size_t capacity() const
+    {
+        return slabs_.size() * SlabSize;
+    }
+};
+
+#endif // MDPLIB_ARENA_H
@@ -8,6 +8,9 @@
 #include <list>
 #include <limits>
 #include <cassert>
+#include <cstdint>
+
+#include "heap.h"
 
 #define vc_vertex first
 #define vc_cost second
@@ -54,7 +57,7 @@ public:
         else return adjList[i][j];
     }
 
-    bool connect(unsigned int i, unsigned int j, double weight)
+    void connect(unsigned int i, unsigned int j, double weight)
     {
         assert(i >= 0 && i < adjList.size() && j >= 0 && j < adjList.size());
         adjList[i][j] = weight;
@@ -92,4 +95,47 @@ std::vector<double> dijkstra(Graph g, int v0);
  */
  bool reachable(Graph g, int u, int v);
 
+/**
+ * Computes the cost of the cheapest path from each vertex to any of the
+ * given targets (a reverse, multi-source Dijkstra), on an implicit graph
+ * with vertices 0, ..., numVertices - 1 and non-negative edge costs.
+ *
+ * The cost of reaching a target is its cost in the targets vector (so that
+ * targets can have different terminal costs). The graph is given by
+ * predecessors(v, edges), which must fill edges with a (u, cost) pair for
+ * every edge u -> v. Vertices that can't reach a target get gr_infinity.
+ */
+template<typename Predecessors>
+std::vector<double> reverseDijkstra(
+    uint32_t numVertices,
+    const std::vector< std::pair<uint32_t, double> >& targets,
+    Predecessors predecessors)
+{
+    std::vector<double> distances(numVertices, gr_infinity);
+    std::vector<bool> closed(numVertices, false);
+    // Keyed by minus the distance, since the heap pops the maximum.
+    IndexedMaxHeap open(numVertices);
+    for (auto const & target : targets) {
+        if (target.second < distances[target.first]) {
+            distances[target.first] = target.second;
+            open.push(target.first, -target.second);
+        }
+    }
+    std::vector< std::pair<uint32_t, double> > edges;
+    while (!open.empty()) {
+        uint32_t v = open.pop();
+        closed[v] = true;
+        edges.clear();
+        predecessors(v, edges);
+        for (auto const & edge : edges) {
+            double distance = distances[v] + edge.second;
+            if (!closed[edge.first] && distance < distances[edge.first]) {
+                distances[edge.first] = distance;
+                open.push(edge.first, -distance);
+            }
+        }
+    }
+    return distances;
+}
+
 #endif // MDPLIB_GRAPH_H
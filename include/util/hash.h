@@ -0,0 +1,38 @@
+#ifndef MDPLIB_HASH_H
+#define MDPLIB_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace mdplib
+{
+
+/**
+ * Mixes the bits of the given value so that every input bit affects every
+ * output bit (the finalizer of SplitMix64).
+ */
+inline uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * Computes a 64-bit hash of the given words.
+ */
+inline uint64_t hashWords(const uint64_t* words, size_t size)
+{
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ size;
+    for (size_t i = 0; i < size; i++)
+        h = mix64(h ^ words[i]);
+    return h;
+}
+
+}
+
+#endif // MDPLIB_HASH_H
@@ -0,0 +1,136 @@
+#ifndef MDPLIB_HEAP_H
+#define MDPLIB_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+/**
+ * A binary max-heap of integer ids in [0, capacity) keyed by a double
+ * priority. The position of each id in the heap is tracked, so that the
+ * priority of an id already in the heap can be changed in O(log n).
+ */
+class IndexedMaxHeap
+{
+private:
+    enum : uint32_t { absent = ~0u };
+
+    /* The heap, as (priority, id) pairs. */
+    std::vector< std::pair<double, uint32_t> > heap_;
+
+    /* Position of each id in heap_ (absent if not in the heap). */
+    std::vector<uint32_t> position_;
+
+    void place(uint32_t i, const std::pair<double, uint32_t>& entry)
+    {
+        heap_[i] = entry;
+        position_[entry.second] = i;
+    }
+
+    void siftUp(uint32_t i)
+    {
+        std::pair<double, uint32_t> entry = heap_[i];
+        while (i > 0) {
+            uint32_t parent = (i - 1) / 2;
+            if (heap_[parent].first >= entry.first)
+                break;
+            place(i, heap_[parent]);
+            i = parent;
+        }
+        place(i, entry);
+    }
+
+    void siftDown(uint32_t i)
+    {
+        std::pair<double, uint32_t> entry = heap_[i];
+        uint32_t n = heap_.size();
+        while (true) {
+            uint32_t child = 2 * i + 1;
+            if (child >= n)
+                break;
+            if (child + 1 < n && heap_[child + 1].first > heap_[child].first)
+                child++;
+            if (entry.first >= heap_[child].first)
+                break;
+            place(i, heap_[child]);
+            i = child;
+        }
+        place(i, entry);
+    }
+
+public:
+    IndexedMaxHeap(uint32_t capacity = 0) : position_(capacity, absent) { }
+
+    bool empty() const { return heap_.empty(); }
+
+    size_t size() const { return heap_.size(); }
+
+    bool contains(uint32_t id) const
+    {
+        return id < position_.size() && position_[id] != absent;
+    }
+
+    /**
+     * Returns the id with the highest priority.
+     */
+    uint32_t top() const { return heap_[0].second; }
+
+    /**
+     * Returns the highest priority in the heap.
+     */
+    double topPriority() const { return heap_[0].first; }
+
+    /**
+     * Inserts the given id with the given priority, or changes its priority
+     * if it is already in the heap.
+     */
+    void push(uint32_t id, double priority)
+    {
+        if (id >= position_.size())
+            position_.resize(id + 1, absent);
+        uint32_t i = position_[id];
+        if (i == absent) {
+            heap_.push_back(std::make_pair(priority, id));
+            siftUp(heap_.size() - 1);
+        } else {
+            double previous = heap_[i].first;
+            heap_[i].first = priority;
+            if (priority > previous)
+                siftUp(i);
+            else
+                siftDown(i);
+        }
+    }
+
+    /**
+     * Removes the given id from the heap, if it is there.
+     */
+    void erase(uint32_t id)
+    {
+        if (!contains(id))
+            return;
+        uint32_t i = position_[id];
+        position_[id] = absent;
+        std::pair<double, uint32_t> last = heap_.back();
+        heap_.pop_back();
+        if (i == heap_.size())
+            return;
+        place(i, last);
+        siftUp(i);
+        siftDown(position_[last.second]);
+    }
+
+    /**
+     * Removes and returns the id with the highest priority.
+     */
+    uint32_t pop()
+    {
+        uint32_t id = heap_[0].second;
+        erase(id);
+        return id;
+    }
+};
+
+#endif // MDPLIB_HEAP_H
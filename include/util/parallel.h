@@ -0,0 +1,74 @@
+#ifndef MDPLIB_PARALLEL_H
+#define MDPLIB_PARALLEL_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Returns the number of hardware threads available (at least 1).
+ */
+inline int hardwareThreads()
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+
+/**
+ * A reusable barrier for a fixed number of threads.
+ *
+ * The last thread to arrive at the barrier runs the given completion
+ * function before the other threads are released, so that it can safely
+ * combine per-thread results and update shared state for the next phase.
+ */
+class Barrier
+{
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int numThreads_;
+    int waiting_;
+    unsigned long generation_;
+
+public:
+    Barrier(int numThreads) :
+        numThreads_(numThreads), waiting_(0), generation_(0) { }
+
+    template<typename Function>
+    void wait(Function completion)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        unsigned long generation = generation_;
+        if (++waiting_ == numThreads_) {
+            completion();
+            waiting_ = 0;
+            generation_++;
+            cv_.notify_all();
+        } else {
+            cv_.wait(lock, [&] { return generation != generation_; });
+        }
+    }
+
+    void wait() { wait([] { }); }
+};
+
+
+/**
+ * Runs function(t) for t = 0, ..., numThreads - 1, each on its own thread,
+ * and waits for all of them to finish. Thread 0 is the calling thread.
+ */
+template<typename Function>
+void runThreads(int numThreads, Function function)
+{
+    std::vector<std::thread> threads;
+    for (int t = 1; t < numThreads; t++)
+        threads.push_back(std::thread(function, t));
+    function(0);
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+#endif // MDPLIB_PARALLEL_H
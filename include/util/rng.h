@@ -0,0 +1,90 @@
+#ifndef MDPLIB_RNG_H
+#define MDPLIB_RNG_H
+
+#include <cstdint>
+
+#include "hash.h"
+
+
+namespace mdplib
+{
+
+/**
+ * A xoshiro256** random number generator whose state is derived from a seed
+ * and a stream number, so that a program can give every thread, trial or
+ * simulation its own stream and get the same numbers for it no matter which
+ * thread draws them.
+ *
+ * Streams with different numbers are statistically independent (their
+ * states are obtained by hashing the pair (seed, stream)). The class meets
+ * the requirements of a uniform random bit generator, so it can be used
+ * with the distributions of <random>.
+ */
+class Rng
+{
+private:
+    uint64_t s_[4];
+
+    static uint64_t rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+public:
+    typedef uint64_t result_type;
+
+    Rng(uint64_t seed = 0, uint64_t stream = 0) { this->seed(seed, stream); }
+
+    /**
+     * Restarts the generator at the beginning of the given stream.
+     */
+    void seed(uint64_t seed, uint64_t stream = 0)
+    {
+        uint64_t words[2] = {seed, stream};
+        uint64_t x = hashWords(words, 2);
+        for (int i = 0; i < 4; i++) {
+            x += 0x9e3779b97f4a7c15ull;
+            s_[i] = mix64(x);
+        }
+        if ((s_[0] | s_[1] | s_[2] | s_[3]) == 0)
+            s_[0] = 1;
+    }
+
+    static constexpr result_type min() { return 0; }
+
+    static constexpr result_type max() { return ~0ull; }
+
+    result_type operator()()
+    {
+        uint64_t result = rotl(s_[1] * 5, 7) * 9;
+        uint64_t t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = rotl(s_[3], 45);
+        return result;
+    }
+
+    /**
+     * Returns a number drawn uniformly from [0, 1).
+     */
+    double uniform()
+    {
+        return ((*this)() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /**
+     * Returns an integer drawn uniformly from {0, ..., n - 1} (n > 0).
+     */
+    uint64_t below(uint64_t n)
+    {
+        uint64_t i = static_cast<uint64_t>(uniform() * n);
+        return i < n ? i : n - 1;
+    }
+};
+
+}
+
+#endif // MDPLIB_RNG_H
@@ -0,0 +1,125 @@
+#include <algorithm>
+
+#include "../include/CompiledProblem.h"
+
+namespace mlcore
+{
+
+void CompiledProblem::append(State* s, unsigned char fixed)
+{
+    uint32_t n = states_.size();
+    if (s->index() != n)
+        others_[s] = n;
+    states_.push_back(s);
+    goal_.push_back(problem_->goal(s));
+    fixed_.push_back(fixed);
+}
+
+
+uint32_t CompiledProblem::addState(State* s)
+{
+    uint32_t n = number(s);
+    if (n != mdplib::no_index)
+        return n;
+    // States stored by the problem while it is compiled keep their index as
+    // their number, which is done by also adding the states stored before
+    // them (which have no actions in the snapshot either).
+    uint32_t i = s->index();
+    if (i < problem_->numStates() && problem_->stateAt(i) == s) {
+        while (states_.size() < i) {
+            State* t = problem_->stateAt(states_.size());
+            if (number(t) != mdplib::no_index)
+                break;
+            append(t, 1);
+        }
+    }
+    n = states_.size();
+    append(s, 1);
+    return n;
+}
+
+
+CompiledProblem::CompiledProblem(Problem* problem) :
+    problem_(problem), gamma_(problem->gamma())
+{
+    for (Action* a : problem->actions())
+        actions_.push_back(a);
+
+    StateTable& stateSet = problem->states();
+    states_.reserve(stateSet.size());
+    for (State* s : stateSet)
+        append(s, 0);
+
+    // Fixed states are appended to states_ while the loop runs, so
+    // the loop bound is taken from the number of states in the state set.
+    uint32_t numCompiled = states_.size();
+    actionBegin_.reserve(numCompiled + 1);
+    successorBegin_.push_back(0);
+    for (uint32_t s = 0; s < numCompiled; s++) {
+        actionBegin_.push_back(actionId_.size());
+        Expansion expansion = problem->expand(states_[s]);
+        // The actions of the expansion are in the order of actions_.
+        uint32_t id = 0;
+        for (size_t i = 0; i < expansion.size(); i++) {
+            while (actions_[id] != expansion.action(i))
+                id++;
+            actionId_.push_back(id);
+            cost_.push_back(expansion.cost(i));
+            for (const Successor& su : expansion.successors(i)) {
+                successorState_.push_back(addState(su.su_state));
+                successorProb_.push_back(su.su_prob);
+            }
+            successorBegin_.push_back(successorState_.size());
+        }
+    }
+    // Fixed states have no actions.
+    while (actionBegin_.size() <= states_.size())
+        actionBegin_.push_back(actionId_.size());
+}
+
+
+std::vector<double> CompiledProblem::initialValues() const
+{
+    std::vector<double> values(states_.size());
+    for (uint32_t s = 0; s < states_.size(); s++)
+        values[s] = states_[s]->cost();
+    return values;
+}
+
+
+std::vector<uint32_t> CompiledProblem::currentPolicy() const
+{
+    std::vector<uint32_t> policy(states_.size(), mdplib::no_index);
+    for (uint32_t s = 0; s < states_.size(); s++) {
+        Action* a = states_[s]->bestAction();
+        if (a == nullptr)
+            continue;
+        for (uint32_t sa = actionBegin_[s]; sa < actionBegin_[s + 1]; sa++) {
+            if (actions_[actionId_[sa]] == a) {
+                policy[s] = sa;
+                break;
+            }
+        }
+    }
+    return policy;
+}
+
+
+void CompiledProblem::commit(const std::vector<double>& values,
+                             const std::vector<uint32_t>& policy) const
+{
+    for (uint32_t s = 0; s < states_.size(); s++) {
+        if (fixed_[s] || goal_[s])
+            continue;
+        State* state = states_[s];
+        if (actionBegin_[s] == actionBegin_[s + 1])
+            state->markDeadEnd();
+        state->setCost(values[s]);
+        if (!policy.empty()) {
+            state->setBestAction(policy[s] == mdplib::no_index ?
+                                 nullptr : action(policy[s]));
+        }
+    }
+}
+
+}
@@ -18,13 +18,22 @@ double State::cost() const
     if (deadEnd())
         return mdplib::dead_end_cost;
 
-    if (cost_ > mdplib::dead_end_cost) {
-        if (problem_ == nullptr || problem_->heuristic() == nullptr)
-            return 0.0;
-        else
-            return problem_->heuristic()->cost(this);
-    }
-    return cost_;
+    double cost = cost_.load(std::memory_order_relaxed);
+    if (cost > mdplib::dead_end_cost)
+        return heuristicCost();
+    return cost;
+}
+
+double State::heuristicCost() const
+{
+    double h = heuristicCost_.load(std::memory_order_relaxed);
+    if (h == h)
+        return h;
+    if (problem_ == nullptr || problem_->heuristic() == nullptr)
+        return 0.0;
+    h = problem_->heuristic()->cost(this);
+    heuristicCost_.store(h, std::memory_order_relaxed);
+    return h;
 }
 
 double State::gValue() const
@@ -36,12 +45,8 @@ double State::gValue() const
 
 double State::hValue() const
 {
-    if (hValue_ > mdplib::dead_end_cost) {
-        if (problem_ == nullptr || problem_->heuristic() == nullptr)
-            return 0.0;
-        else
-            return problem_->heuristic()->cost(this);
-    }
+    if (hValue_ > mdplib::dead_end_cost)
+        return heuristicCost();
     return hValue_;
 }
 
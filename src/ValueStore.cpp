@@ -0,0 +1,19 @@
+#include "../include/Heuristic.h"
+#include "../include/MDPLib.h"
+#include "../include/Problem.h"
+#include "../include/ValueStore.h"
+
+namespace mlcore
+{
+
+double ValueStore::cost(uint32_t i) const
+{
+    if (deadEnd_[i])
+        return mdplib::dead_end_cost;
+
+    if (cost_[i] > mdplib::dead_end_cost)
+        return problem_->stateAt(i)->heuristicCost();
+    return cost_[i];
+}
+
+}
@@ -50,9 +50,15 @@ bool WrapperProblem::applicable(mlcore::State* s, mlcore::Action* a) const
 }
 
 
-mlcore::StateSet& WrapperProblem::states()
+mlcore::StateTable& WrapperProblem::states()
 {
-    if (overrideStates_ != nullptr && !overrideStates_->empty())
-        return *overrideStates_;
+    if (overrideStates_ != nullptr && !overrideStates_->empty()) {
+        // The override set can change between calls, so the table is
+        // rebuilt every time.
+        overrideTable_.clear();
+        for (mlcore::State* s : *overrideStates_)
+            overrideTable_.insert(s);
+        return overrideTable_;
+    }
     return problem_->states();
 }
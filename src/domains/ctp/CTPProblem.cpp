@@ -22,6 +22,8 @@ void CTPProblem::init()
         }
     }
     actions_.push_back(new CTPAction(-1,-1));
+    actionTable_.assign(actions_.begin(), actions_.end());
+    cacheSamplers_ = true;
 }
 
 CTPProblem::CTPProblem(Graph* roads,
@@ -76,17 +78,24 @@ bool CTPProblem::goal(mlcore::State* s) const
 
 std::list<mlcore::Successor>
 CTPProblem::transition(mlcore::State* s, mlcore::Action* a)
+{
+    mlcore::SuccessorView view = successors(s, a);
+    return std::list<mlcore::Successor>(view.begin(), view.end());
+}
+
+mlcore::SuccessorView
+CTPProblem::successors(mlcore::State* s, mlcore::Action* a)
 {
     assert(applicable(s, a));
 
-    std::list<mlcore::Successor> successors;
+    mlcore::SuccessorView successors = mlcore::SuccessorView::scratch();
     if (s == absorbing_) {
-        successors.push_front(mlcore::Successor(s, 1.0));
+        successors.push_back(mlcore::Successor(s, 1.0));
         return successors;
     }
 
     if (goal(s)) {
-        successors.push_front(mlcore::Successor(absorbing_, 1.0));
+        successors.push_back(mlcore::Successor(absorbing_, 1.0));
         return successors;
     }
 
@@ -102,9 +111,11 @@ CTPProblem::transition(mlcore::State* s, mlcore::Action* a)
             neighbors.push_back(entry.first);
     }
     int nadj = neighbors.size();
+    int n = roads_->numVertices();
+    /* The key of each successor, built without copying the state */
+    std::vector<uint64_t> key(ctps->packMoveKey(to, nullptr, 0));
+    ctps->packMoveKey(to, key.data(), key.size());
     for (int i = 0; i < (1 << nadj); i++) {
-        CTPState* next = new CTPState(*ctps);
-        next->setLocation(to);
         double p = 1.0;
         /* Updating adjacent roads */
         for (int j = 0; j < nadj; j++) {
@@ -113,15 +124,48 @@ CTPProblem::transition(mlcore::State* s, mlcore::Action* a)
             p *= (st == ctp::BLOCKED) ?
                     1.0 - probs_[to][neighbors[j]] :
                     probs_[to][neighbors[j]];
-            next->setStatus(to, neighbors[j], st);
-            next->setStatus(neighbors[j], to, st);
+            CTPState::setKeyStatus(key.data(), n, to, neighbors[j], st);
+            CTPState::setKeyStatus(key.data(), n, neighbors[j], to, st);
         }
-        next->explored().insert(to);
-        successors.push_back(mlcore::Successor(this->addState(next), p));
+        mlcore::State* next = this->addState(key.data(), key.size(), [&] {
+            CTPState* state = this->newState<CTPState>(*ctps);
+            state->setLocation(to);
+            for (int j = 0; j < nadj; j++) {
+                unsigned char st = (i & (1<<j)) ? ctp::OPEN : ctp::BLOCKED;
+                state->setStatus(to, neighbors[j], st);
+                state->setStatus(neighbors[j], to, st);
+            }
+            state->explored().insert(to);
+            return state;
+        });
+        successors.push_back(mlcore::Successor(next, p));
     }
     return successors;
 }
 
+mlcore::Expansion CTPProblem::expand(mlcore::State* s)
+{
+    mlcore::Expansion expansion = mlcore::Expansion::scratch();
+    CTPState* ctps = static_cast<CTPState*>(s);
+    int n = roads_->numVertices();
+    // Only the actions leaving the current location can be applicable
+    // (or the last action, at the goal and absorbing states).
+    int begin = n * n, end = n * n + 1;
+    if (s != absorbing_ && !goal(s)) {
+        begin = n * ctps->location();
+        end = begin + n;
+    }
+    for (int i = begin; i < end; i++) {
+        mlcore::Action* a = actionTable_[i];
+        if (!applicable(s, a))
+            continue;
+        expansion.addAction(a, cost(s, a));
+        for (const mlcore::Successor& su : successors(s, a))
+            expansion.push_back(su);
+    }
+    return expansion;
+}
+
 double CTPProblem::cost(mlcore::State* s, mlcore::Action* a) const
 {
     assert(applicable(s, a));
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "../../../include/domains/ctp/CTPState.h"
 #include "../../../include/domains/ctp/CTPProblem.h"
 
@@ -212,3 +214,48 @@ double CTPState::distanceOptimistic(int v)
     }
     return distances[v];
 }
+
+unsigned CTPState::packKey(uint64_t* key, unsigned size) const
+{
+    if (location_ == -1) {
+        key[0] = (uint64_t) -1;     // all absorbing states are equal
+        return 1;
+    }
+    // The location, the status of the roads (4 bits each) and the explored
+    // vertices (as a bit mask).
+    int n = static_cast<CTPProblem*>(problem_)->roads()->numVertices();
+    unsigned words = 1 + (n * n + 15) / 16 + (n + 63) / 64;
+    if (words > size)
+        return words;
+    std::fill(key, key + words, 0);
+    key[0] = (uint32_t) location_;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++)
+            setKeyStatus(key, n, i, j, status_[i][j]);
+    }
+    uint64_t* explored = key + 1 + (n * n + 15) / 16;
+    for (int v : explored_)
+        explored[v / 64] |= 1ull << (v % 64);
+    return words;
+}
+
+unsigned CTPState::packMoveKey(int to, uint64_t* key, unsigned size) const
+{
+    unsigned words = packKey(key, size);
+    if (words > size)
+        return words;
+    int n = static_cast<CTPProblem*>(problem_)->roads()->numVertices();
+    key[0] = (uint32_t) to;
+    uint64_t* explored = key + 1 + (n * n + 15) / 16;
+    explored[to / 64] |= 1ull << (to % 64);
+    return words;
+}
+
+void CTPState::setKeyStatus(uint64_t* key, int n,
+                            int i, int j, unsigned char status)
+{
+    int k = i * n + j;
+    uint64_t& word = key[1 + k / 16];
+    int shift = 4 * (k % 16);
+    word = (word & ~(15ull << shift)) | (uint64_t) (status & 15) << shift;
+}
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+#include "../../../include/MDPLib.h"
+#include "../../../include/util/graph.h"
+
+#include "../../../include/domains/gridworld/GridWorldState.h"
+#include "../../../include/domains/gridworld/GWDijkstraHeuristic.h"
+
+GWDijkstraHeuristic::GWDijkstraHeuristic(GridWorldProblem* problem)
+{
+    const GridWorldMap& map = problem->map();
+    width_ = map.width();
+    int height = map.height();
+    assert(uint64_t(width_) * height < UINT32_MAX);
+    double actionCost = problem->actionCost_;
+    double holeCost = problem->holeCost_ * problem->actionCost_;
+
+    std::vector< std::pair<uint32_t, double> > goals;
+    for (auto const & goalEntry : *problem->goals_) {
+        int x = goalEntry.first.first, y = goalEntry.first.second;
+        if (map.contains(x, y))
+            goals.push_back(
+                std::make_pair(uint32_t(y) * width_ + x, goalEntry.second));
+    }
+
+    // Any non-wall neighbor can be reached from a cell with some action,
+    // paying the cost of the cell left. Goals and dead-ends can't be left.
+    static const int dx[] = {0, 0, -1, 1};
+    static const int dy[] = {1, -1, 0, 0};
+    int width = width_;
+    costs_ = reverseDijkstra(
+        uint32_t(width_) * height, goals,
+        [&] (uint32_t v, std::vector< std::pair<uint32_t, double> >& edges) {
+            int x = v % width, y = v / width;
+            for (int i = 0; i < 4; i++) {
+                int ux = x + dx[i], uy = y + dy[i];
+                if (!map.contains(ux, uy))
+                    continue;
+                unsigned char type = map.cell(ux, uy);
+                uint32_t u = uint32_t(uy) * width + ux;
+                if (type == gridworld::FREE)
+                    edges.push_back(std::make_pair(u, actionCost));
+                else if (type == gridworld::HOLE)
+                    edges.push_back(std::make_pair(u, holeCost));
+            }
+        });
+}
+
+
+double GWDijkstraHeuristic::cost(const mlcore::State* s)
+{
+    const GridWorldState* gws = static_cast<const GridWorldState*>(s);
+    if (gws->x() == -1) // absorbing dummy state
+        return 0.0;
+    return std::min(costs_[size_t(gws->y()) * width_ + gws->x()],
+                    mdplib::dead_end_cost);
+}
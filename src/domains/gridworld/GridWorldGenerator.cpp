@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+#include "../../../include/util/hash.h"
+#include "../../../include/util/rng.h"
+
+#include "../../../include/domains/gridworld/GridWorldGenerator.h"
+
+
+GridWorldGenerator::GridWorldGenerator(int width, int height, uint64_t seed)
+    : width_(width), height_(height), seed_(seed),
+      walls_(0.0), holes_(0.0), deadEnds_(0.0),
+      x0_(0), y0_(0), corridors_(true)
+{
+    assert(width > 0 && height > 0);
+    update();
+}
+
+
+void GridWorldGenerator::start(int x, int y)
+{
+    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+    x0_ = x;
+    y0_ = y;
+    update();
+}
+
+
+void GridWorldGenerator::addGoal(int x, int y)
+{
+    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+    goals_.push_back(std::make_pair(x, y));
+    update();
+}
+
+
+void GridWorldGenerator::addRandomGoals(int n)
+{
+    uint64_t numCells = static_cast<uint64_t>(width_) * height_;
+    // Each call draws from its own stream, so that the goals only depend on
+    // the seed and on the sequence of calls.
+    mdplib::Rng rng(seed_, goals_.size() + 1);
+    std::vector<uint64_t> taken(goalCells_);
+    if (goals_.empty())
+        taken.clear();  // The default goal is replaced by the new ones.
+    taken.push_back(index(x0_, y0_));
+    std::sort(taken.begin(), taken.end());
+    for (int i = 0; i < n && taken.size() < numCells; i++) {
+        uint64_t cell;
+        do {
+            cell = rng.below(numCells);
+        } while (std::binary_search(taken.begin(), taken.end(), cell));
+        taken.insert(std::lower_bound(taken.begin(), taken.end(), cell), cell);
+        goals_.push_back(std::make_pair(int(cell % width_), int(cell / width_)));
+    }
+    update();
+}
+
+
+std::vector<std::pair<int, int> > GridWorldGenerator::goals() const
+{
+    if (!goals_.empty())
+        return goals_;
+    return std::vector<std::pair<int, int> >(
+        1, std::make_pair(width_ - 1 - x0_, height_ - 1 - y0_));
+}
+
+
+void GridWorldGenerator::update()
+{
+    std::vector<std::pair<int, int> > goals = this->goals();
+    goalCells_.clear();
+    for (auto const & goal : goals)
+        goalCells_.push_back(index(goal.first, goal.second));
+    std::sort(goalCells_.begin(), goalCells_.end());
+
+    // The corridor of a column runs from the start's row to its farthest
+    // goals in both directions (empty if the column has no goals).
+    top_.assign(width_, height_);
+    bottom_.assign(width_, -1);
+    if (!corridors_)
+        return;
+    for (auto const & goal : goals) {
+        int x = goal.first;
+        top_[x] = std::min(top_[x], std::min(goal.second, y0_));
+        bottom_[x] = std::max(bottom_[x], std::max(goal.second, y0_));
+    }
+}
+
+
+unsigned char GridWorldGenerator::cell(int x, int y) const
+{
+    uint64_t i = index(x, y);
+    if (std::binary_search(goalCells_.begin(), goalCells_.end(), i))
+        return gridworld::GOAL;
+    if (x == x0_ && y == y0_)
+        return gridworld::FREE;
+    uint64_t words[2] = {seed_, i};
+    double u = (mdplib::hashWords(words, 2) >> 11) *
+        (1.0 / 9007199254740992.0);
+    bool corridor = corridors_ &&
+        (y == y0_ || (y >= top_[x] && y <= bottom_[x]));
+    if (u < walls_)
+        return corridor ? gridworld::FREE : gridworld::WALL;
+    u -= walls_;
+    if (u < holes_)
+        return gridworld::HOLE;
+    u -= holes_;
+    if (u < deadEnds_)
+        return corridor ? gridworld::FREE : gridworld::DEAD_END;
+    return gridworld::FREE;
+}
+
+
+void GridWorldGenerator::write(std::ostream& os) const
+{
+    std::string row(width_ + 1, '\n');
+    for (int y = 0; y < height_; y++) {
+        for (int x = 0; x < width_; x++)
+            row[x] = GridWorldMap::symbol(cell(x, y));
+        if (y == y0_)
+            row[x0_] = 'S';
+        os.write(row.data(), row.size());
+    }
+}
@@ -1,7 +1,10 @@
+#include <algorithm>
 #include <cassert>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include "../../../include/Problem.h"
 #include "../../../include/domains/gridworld/GridWorldProblem.h"
@@ -27,6 +30,7 @@ GridWorldProblem::GridWorldProblem() :
 {
     absorbing = new GridWorldState(this, -1, -1);
     addAllActions();
+    cacheSamplers_ = true;
 }
 
 
@@ -39,36 +43,47 @@ GridWorldProblem::GridWorldProblem(const char* filename,
 
     goals_ = new PairDoubleMap();
 
-    // Once the file is finished parsing, these will have correct values
-    width_ = 0, height_ = 0;
     if (myfile.is_open()) {
+        // Lines may have different lengths; the map is as wide as the
+        // longest one, ignoring trailing spaces, and shorter lines are
+        // padded with free cells.
+        std::vector<std::string> lines;
+        size_t width = 0;
         std::string line;
         while ( std::getline (myfile, line) ) {
-            for (width_ = 0; width_ < line.size(); width_++) {
-                if (line.at(width_) == 'x') {
-                    walls.insert(std::pair<int, int>(width_, height_));
-                } else if (line.at(width_) == '@') {
-                    holes.insert(std::pair<int, int>(width_, height_));
-                } else if (line.at(width_) == 'G') {
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+                line.pop_back();
+            width = std::max(width, line.size());
+            lines.push_back(line);
+        }
+        myfile.close();
+        for (int y = 0; y < int(lines.size()); y++) {
+            const std::string& line = lines[y];
+            unsigned char* row = map_.addRow(width);
+            for (int x = 0; x < int(line.size()); x++) {
+                int type = GridWorldMap::cellType(line[x]);
+                if (type == -1) {
+                    std::cerr << "Unknown cell '" << line[x] << "' at line "
+                              << y + 1 << ", column " << x + 1 << " of "
+                              << filename << std::endl;
+                    exit(-1);
+                }
+                row[x] = type;
+                if (type == gridworld::GOAL) {
                     goals_->insert(
-                        std::make_pair(
-                            std::pair<int,int> (width_, height_), 0.0));
-                } else if (line.at(width_) == 'D') {
-                    dead_ends.insert(std::pair<int, int> (width_, height_));
-                } else if (line.at(width_) == 'S') {
-                    x0_ = width_;
-                    y0_ = height_;
-                } else {
-                    assert(line.at(width_) == '.');
+                        std::make_pair(std::pair<int,int> (x, y), 0.0));
+                } else if (line[x] == 'S') {
+                    x0_ = x;
+                    y0_ = y;
                 }
             }
-            height_++;
         }
-        myfile.close();
     } else {
         std::cerr << "Invalid file " << filename << std::endl;
         exit(-1);
     }
+    width_ = map_.width();
+    height_ = map_.height();
     actionCost_ = actionCost;
     holeCost_ = holeCost;
     allDirections_ = allDirections;
@@ -77,6 +92,33 @@ GridWorldProblem::GridWorldProblem(const char* filename,
     this->addState(s0);
     this->addState(absorbing);
     addAllActions();
+    cacheSamplers_ = true;
+}
+
+
+GridWorldProblem::GridWorldProblem(const GridWorldGenerator& generator,
+                                   double actionCost,
+                                   double holeCost,
+                                   bool allDirections) :
+        width_(generator.width()), height_(generator.height()),
+        x0_(generator.x0()), y0_(generator.y0()),
+        actionCost_(actionCost), holeCost_(holeCost),
+        allDirections_(allDirections),
+        map_(generator.width(), generator.height())
+{
+    goals_ = new PairDoubleMap();
+    for (auto const & goal : generator.goals())
+        (*goals_)[goal] = 0.0;
+    for (int y = 0; y < height_; y++) {
+        for (int x = 0; x < width_; x++)
+            map_.cell(x, y, generator.cell(x, y));
+    }
+    s0 = new GridWorldState(this, x0_, y0_);
+    absorbing = new GridWorldState(this, -1, -1);
+    this->addState(s0);
+    this->addState(absorbing);
+    addAllActions();
+    cacheSamplers_ = true;
 }
 
 
@@ -84,15 +126,17 @@ GridWorldProblem::GridWorldProblem(
     int width, int height, int x0, int y0,
     PairDoubleMap* goals, double actionCost) :
         width_(width), height_(height), x0_(x0), y0_(y0),
-        actionCost_(actionCost)
+        actionCost_(actionCost), map_(width, height)
 {
     goals_ = new PairDoubleMap();
     for (auto const & goalEntry : *goals)
         (*goals_)[goalEntry.first] = goalEntry.second;
+    markGoals();
     s0 = new GridWorldState(this, x0_, y0_);
     absorbing = new GridWorldState(this, -1, -1);
     this->addState(s0);
     addAllActions();
+    cacheSamplers_ = true;
 }
 
 
@@ -100,24 +144,36 @@ GridWorldProblem::GridWorldProblem(int width, int height,
                                    int x0, int y0,
                                    PairDoubleMap* goals, mlcore::Heuristic* h)
                                    : width_(width), height_(height),
-                                     x0_(x0), y0_(y0)
+                                     x0_(x0), y0_(y0),
+                                     map_(width, height)
 {
     goals_ = new PairDoubleMap();
     for (auto const & goalEntry : *goals)
         (*goals_)[goalEntry.first] = goalEntry.second;
+    markGoals();
     s0 = new GridWorldState(this, x0_, y0_);
     absorbing = new GridWorldState(this, -1, -1);
     this->addState(s0);
     heuristic_ = h;
     gamma_ = 1.0;
     addAllActions();
+    cacheSamplers_ = true;
+}
+
+
+void GridWorldProblem::markGoals()
+{
+    for (auto const & goalEntry : *goals_) {
+        int x = goalEntry.first.first, y = goalEntry.first.second;
+        if (map_.contains(x, y))
+            map_.cell(x, y, gridworld::GOAL);
+    }
 }
 
 
 bool GridWorldProblem::gridGoal(GridWorldState* gws) const
 {
-    std::pair<int,int> pos(gws->x(),gws->y());
-    return goals_->find(pos) != goals_->end();
+    return map_.cell(gws->x(), gws->y()) == gridworld::GOAL;
 }
 
 
@@ -129,20 +185,28 @@ bool GridWorldProblem::goal(mlcore::State* s) const
 
 std::list<mlcore::Successor>
 GridWorldProblem::transition(mlcore::State *s, mlcore::Action *a)
+{
+    mlcore::SuccessorView view = successors(s, a);
+    return std::list<mlcore::Successor>(view.begin(), view.end());
+}
+
+
+mlcore::SuccessorView
+GridWorldProblem::successors(mlcore::State *s, mlcore::Action *a)
 {
     GridWorldState* state = static_cast<GridWorldState *> (s);
     GridWorldAction* action = static_cast<GridWorldAction *> (a);
 
-    std::list<mlcore::Successor> successors;
+    mlcore::SuccessorView successors = mlcore::SuccessorView::scratch();
 
     if (s == absorbing || gridGoal(state)) {
-        successors.push_front(mlcore::Successor(absorbing, 1.0));
+        successors.push_back(mlcore::Successor(absorbing, 1.0));
         return successors;
     }
 
-    if (dead_ends.count(std::pair<int, int>(state->x(), state->y()))) {
+    if (map_.cell(state->x(), state->y()) == gridworld::DEAD_END) {
         s->markDeadEnd();
-        successors.push_front(mlcore::Successor(s, 1.0));
+        successors.push_back(mlcore::Successor(s, 1.0));
         return successors;
     }
 
@@ -219,7 +283,7 @@ double GridWorldProblem::cost(mlcore::State* s, mlcore::Action* a) const
         std::pair<int,int> pos(gws->x(),gws->y());
         return (*goals_)[pos];
     }
-    if (holes.count(std::pair<int, int> (gws->x(), gws->y())) != 0)
+    if (map_.cell(gws->x(), gws->y()) == gridworld::HOLE)
         return holeCost_ * actionCost_;
     return actionCost_;
 }
@@ -232,14 +296,16 @@ bool GridWorldProblem::applicable(mlcore::State* s, mlcore::Action* a) const
 
 
 void GridWorldProblem::addSuccessor(
-    GridWorldState* state, std::list<mlcore::Successor>& successors,
+    GridWorldState* state, mlcore::SuccessorView& successors,
     int val, int limit, int newx, int newy, double prob)
 {
-    bool isWall = (walls.count(std::pair<int, int> (newx, newy)) != 0);
-    if (val > limit && !isWall) {
-        GridWorldState *next = new GridWorldState(this, newx, newy);
-        successors.push_front(mlcore::Successor(this->addState(next), prob));
+    if (val > limit && map_.cell(newx, newy) != gridworld::WALL) {
+        uint64_t key = GridWorldState::makeKey(newx, newy);
+        mlcore::State* next = this->addState(&key, 1, [&] {
+            return this->newState<GridWorldState>(this, newx, newy);
+        });
+        successors.push_back(mlcore::Successor(next, prob));
     } else {
-        successors.push_front(mlcore::Successor(state, prob));
+        successors.push_back(mlcore::Successor(state, prob));
     }
 }
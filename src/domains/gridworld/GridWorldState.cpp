@@ -25,6 +25,12 @@ int GridWorldState::hashValue() const
     return x_ + 31*y_;
 }
 
+unsigned GridWorldState::packKey(uint64_t* key, unsigned /* size */) const
+{
+    key[0] = makeKey(x_, y_);
+    return 1;
+}
+
 int GridWorldState::x() const
 {
     return x_;
@@ -1,34 +1,138 @@
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <ctime>
+#include <fstream>
 
 #include "../../../include/State.h"
 #include "../../../include/solvers/VISolver.h"
+#include "../../../include/util/hash.h"
+#include "../../../include/util/parallel.h"
 
 #include "../../../include/domains/racetrack/RacetrackProblem.h"
 #include "../../../include/domains/racetrack/RacetrackState.h"
 #include "../../../include/domains/racetrack/RTrackDetHeuristic.h"
 
-RTrackDetHeuristic::RTrackDetHeuristic(const char* filename)
+namespace
 {
-    detProblem_ = new RacetrackProblem(filename);
-    detProblem_->pSlip(0.00);
-    detProblem_->pError(0.00);
-    detProblem_->generateAll();
-    mlsolvers::VISolver vi(detProblem_, 1000, 0.001);
+/* Identifies the files written by RTrackDetHeuristic::save(). */
+const uint64_t file_magic = 0x3148444b43415254ull;   // "TRACKDH1"
+
+/* Returns a hash of the cells of the track. */
+uint64_t trackFingerprint(const std::vector<std::vector<char> >& track)
+{
+    std::vector<uint64_t> words;
+    for (const std::vector<char>& row : track) {
+        words.push_back(row.size());
+        for (char c : row)
+            words.push_back((unsigned char) c);
+    }
+    return mdplib::hashWords(words.data(), words.size());
+}
+}
+
+RTrackDetHeuristic::RTrackDetHeuristic(const char* filename,
+                                       const char* cacheFilename)
+{
+    RacetrackProblem detProblem(filename);
+    uint64_t fingerprint = trackFingerprint(detProblem.track());
+    if (cacheFilename != nullptr && load(cacheFilename, fingerprint))
+        return;
+    compute(&detProblem);
+    if (cacheFilename != nullptr)
+        save(cacheFilename, fingerprint);
+}
+
+void RTrackDetHeuristic::compute(RacetrackProblem* detProblem)
+{
+    detProblem->pSlip(0.00);
+    detProblem->pError(0.00);
+    mlcore::GenerateOptions options;
+    options.numThreads = hardwareThreads();
+    detProblem->generateAll(options);
+    mlsolvers::VISolver vi(detProblem, 1000, 0.001);
+    vi.numThreads(hardwareThreads());
     vi.solve();
+
+    width_ = detProblem->track().size();
+    height_ = width_ > 0 ? detProblem->track()[0].size() : 0;
+    int maxVx = INT_MIN, maxVy = INT_MIN;
+    minVx_ = INT_MAX;
+    minVy_ = INT_MAX;
+    for (mlcore::State* s : detProblem->states()) {
+        RacetrackState* rts = static_cast<RacetrackState*>(s);
+        if (rts->x() < 0)
+            continue;
+        minVx_ = std::min(minVx_, rts->vx());
+        maxVx = std::max(maxVx, rts->vx());
+        minVy_ = std::min(minVy_, rts->vy());
+        maxVy = std::max(maxVy, rts->vy());
+    }
+    if (minVx_ > maxVx) {
+        minVx_ = maxVx = minVy_ = maxVy = 0;
+    }
+    numVx_ = maxVx - minVx_ + 1;
+    numVy_ = maxVy - minVy_ + 1;
+    costs_.assign(long(width_) * height_ * numVx_ * numVy_, 0.0);
+    initialCost_ = detProblem->initialState()->cost();
+    absorbingCost_ = detProblem->absorbing()->cost();
+    for (mlcore::State* s : detProblem->states()) {
+        RacetrackState* rts = static_cast<RacetrackState*>(s);
+        long i = index(rts->x(), rts->y(), rts->vx(), rts->vy());
+        if (i >= 0)
+            costs_[i] = s->cost();
+    }
+}
+
+bool RTrackDetHeuristic::load(const char* filename, uint64_t fingerprint)
+{
+    std::ifstream in(filename, std::ios::binary);
+    if (!in.is_open())
+        return false;
+    uint64_t magic = 0, storedFingerprint = 0;
+    in.read((char*) &magic, sizeof(magic));
+    in.read((char*) &storedFingerprint, sizeof(storedFingerprint));
+    if (!in || magic != file_magic || storedFingerprint != fingerprint)
+        return false;
+    int32_t dims[6];
+    in.read((char*) dims, sizeof(dims));
+    in.read((char*) &initialCost_, sizeof(initialCost_));
+    in.read((char*) &absorbingCost_, sizeof(absorbingCost_));
+    if (!in || dims[0] < 0 || dims[1] < 0 || dims[3] < 0 || dims[5] < 0)
+        return false;
+    width_ = dims[0];
+    height_ = dims[1];
+    minVx_ = dims[2];
+    numVx_ = dims[3];
+    minVy_ = dims[4];
+    numVy_ = dims[5];
+    costs_.resize(long(width_) * height_ * numVx_ * numVy_);
+    in.read((char*) costs_.data(), costs_.size() * sizeof(double));
+    return bool(in);
+}
+
+void RTrackDetHeuristic::save(const char* filename, uint64_t fingerprint) const
+{
+    std::ofstream out(filename, std::ios::binary);
+    if (!out.is_open())
+        return;
+    int32_t dims[6] = {width_, height_, minVx_, numVx_, minVy_, numVy_};
+    out.write((const char*) &file_magic, sizeof(file_magic));
+    out.write((const char*) &fingerprint, sizeof(fingerprint));
+    out.write((const char*) dims, sizeof(dims));
+    out.write((const char*) &initialCost_, sizeof(initialCost_));
+    out.write((const char*) &absorbingCost_, sizeof(absorbingCost_));
+    out.write((const char*) costs_.data(), costs_.size() * sizeof(double));
 }
 
 double RTrackDetHeuristic::cost(const mlcore::State* s)
 {
     const RacetrackState* rts = static_cast<const RacetrackState*>(s);
-    RacetrackState* tmp = new RacetrackState(rts->x(),
-                                             rts->y(),
-                                             rts->vx(),
-                                             rts->vy(),
-                                             detProblem_);
-    mlcore::StateSet::const_iterator it =
-        detProblem_->states().find((mlcore::State *) tmp);
-    assert(it != detProblem_->states().end());
-    delete tmp;
-    return (*it)->cost();
+    if (rts->x() == -1)
+        return initialCost_;
+    if (rts->x() == -2)
+        return absorbingCost_;
+    long i = index(rts->x(), rts->y(), rts->vx(), rts->vy());
+    assert(i >= 0);
+    return i >= 0 ? costs_[i] : 0.0;
 }
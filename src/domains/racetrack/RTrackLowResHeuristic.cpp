@@ -95,15 +95,14 @@ RTrackLowResHeuristic::~RTrackLowResHeuristic()
 double RTrackLowResHeuristic::cost(const mlcore::State* s) const
 {
     const RacetrackState* rts = static_cast<const RacetrackState*>(s);
-    RacetrackState* tmp = new RacetrackState(rts->x() / resolution_ + 1,
-                                             rts->y() / resolution_ + 1,
-                                             rts->vx() / resolution_,
-                                             rts->vy() / resolution_,
-                                             lowResProblem_);
-    mlcore::StateSet::const_iterator it =
-        lowResProblem_->states().find(static_cast<mlcore::State*>(tmp));
-    if (it == lowResProblem_->states().end())
+    uint64_t key[2];
+    unsigned keySize = RacetrackState::makeKey(rts->x() / resolution_ + 1,
+                                               rts->y() / resolution_ + 1,
+                                               rts->vx() / resolution_,
+                                               rts->vy() / resolution_,
+                                               key);
+    mlcore::State* lowResState = lowResProblem_->getState(key, keySize);
+    if (lowResState == nullptr)
         return 0.0;
-    delete tmp;
-    return .75 * (*it)->cost();
+    return .75 * lowResState->cost();
 }
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 #include <cassert>
 #include <unistd.h>
@@ -6,6 +7,8 @@
 #include <sstream>
 #include <cmath>
 
+#include "../../../include/util/hash.h"
+
 #include "../../../include/domains/racetrack/RacetrackProblem.h"
 #include "../../../include/domains/racetrack/RacetrackState.h"
 #include "../../../include/domains/racetrack/RacetrackAction.h"
@@ -58,6 +61,26 @@ RacetrackProblem::RacetrackProblem(const char* filename)
     for (int ax = -1; ax <= 1; ax++)
         for (int ay = -1; ay <= 1; ay++)
         actions_.push_back(new RacetrackAction(ax, ay));
+
+    cacheSamplers_ = true;
+    resetRays();
+}
+
+
+void RacetrackProblem::resetRays()
+{
+    rayStride_ = 0;
+    for (const std::vector<char>& row : track_)
+        rayStride_ = std::max(rayStride_, (int) row.size());
+    // Two entries per cell, up to 8M entries (64 MB). Most cells are only
+    // reached with a few velocities, and rays that don't fit are cast again.
+    size_t cells = track_.size() * rayStride_;
+    size_t size = 1024;
+    while (size < 2 * cells && size < (size_t(1) << 23))
+        size *= 2;
+    std::vector< std::atomic<uint64_t> >(size).swap(rays_);
+    for (std::atomic<uint64_t>& entry : rays_)
+        entry.store(0, std::memory_order_relaxed);
 }
 
 
@@ -84,25 +107,31 @@ bool RacetrackProblem::goal(mlcore::State* s) const
 
 std::list<mlcore::Successor>
 RacetrackProblem::transition(mlcore::State* s, mlcore::Action* a)
+{
+    mlcore::SuccessorView view = successors(s, a);
+    return std::list<mlcore::Successor>(view.begin(), view.end());
+}
+
+
+mlcore::SuccessorView
+RacetrackProblem::successors(mlcore::State* s, mlcore::Action* a)
 {
     if (useFlatTransition_)
-        return flatTransition(s, a);
+        return flatSuccessors(s, a);
 
     assert(applicable(s, a));
 
     if (s == s0) {
-        std::list<mlcore::Successor> successors;
+        mlcore::SuccessorView successors = mlcore::SuccessorView::scratch();
         for (std::pair<int,int> start : starts_) {
-            mlcore::State* next =
-                new RacetrackState(start.first, start.second, 0, 0, this);
-            successors.push_back(mlcore::Successor(this->addState(next),
-                                 1.0 / starts_.size()));
+            mlcore::State* next = makeState(start.first, start.second, 0, 0);
+            successors.push_back(mlcore::Successor(next, 1.0 / starts_.size()));
         }
         return successors;
     }
 
     if (goal(s) || s == absorbing_) {
-        std::list<mlcore::Successor> successors;
+        mlcore::SuccessorView successors = mlcore::SuccessorView::scratch();
         successors.push_back(
             mlcore::Successor(this->addState(absorbing_), 1.0));
         return successors;
@@ -111,22 +140,23 @@ RacetrackProblem::transition(mlcore::State* s, mlcore::Action* a)
     RacetrackState* rts = static_cast<RacetrackState*>(s);
     RacetrackAction* rta = static_cast<RacetrackAction*>(a);
 
-    int idAction = rta->hashValue();
-    std::vector<mlcore::SuccessorsList>* allSuccessors = rts->allSuccessors();
+    return cachedSuccessors(rts, rta);
+}
 
-    if (!allSuccessors->at(idAction).empty()) {
-        return allSuccessors->at(idAction);
-    }
+
+mlcore::SuccessorView
+RacetrackProblem::actionSuccessors(RacetrackState* rts, RacetrackAction* rta)
+{
+    mlcore::SuccessorView successors = mlcore::SuccessorView::scratch();
 
     /* At walls the car can deterministically move to the track again */
     if (track_[rts->x()][rts->y()] == rtrack::wall ||
             track_[rts->x()][rts->y()] == rtrack::pothole) {
         int x = rts->x(), y = rts->y();
         int ax = rta->ax(), ay = rta->ay();
-        mlcore::State* next =
-          this->addState(new RacetrackState(x + ax, y + ay, ax, ay, this));
-        allSuccessors->at(idAction).push_back(mlcore::Successor(next, 1.0));
-        return allSuccessors->at(idAction);
+        mlcore::State* next = makeState(x + ax, y + ay, ax, ay);
+        successors.push_back(mlcore::Successor(next, 1.0));
+        return successors;
     }
 
     bool isDet = (abs(rts->vx()) + abs(rts->vy())) < mds_;
@@ -142,14 +172,13 @@ RacetrackProblem::transition(mlcore::State* s, mlcore::Action* a)
 
     double acc = 0.0;
     if (p_slip != 0.0) {
-        mlcore::State* next = this->addState(resultingState(rts, 0, 0));
-        allSuccessors->at(idAction).push_back(mlcore::Successor(next, pSlip_));
+        mlcore::State* next = resultingState(rts, 0, 0);
+        successors.push_back(mlcore::Successor(next, pSlip_));
         acc += pSlip_;
     }
     if (p_int != 0.0) {
-        mlcore::State* next =
-            this->addState(resultingState(rts, rta->ax(), rta->ay()));
-        allSuccessors->at(idAction).push_back(mlcore::Successor(next, p_int));
+        mlcore::State* next = resultingState(rts, rta->ax(), rta->ay());
+        successors.push_back(mlcore::Successor(next, p_int));
         acc += p_int;
     }
     if (p_err != 0.0) {
@@ -168,16 +197,38 @@ RacetrackProblem::transition(mlcore::State* s, mlcore::Action* a)
             if (dist == 0 || dist > 1)
                 continue;
             mlcore::State* next =
-                this->addState(resultingState(rts, rtaE->ax(), rtaE->ay()));
-            allSuccessors->at(idAction).
-                push_back(mlcore::Successor(next, p_err / cnt));
+                resultingState(rts, rtaE->ax(), rtaE->ay());
+            successors.push_back(mlcore::Successor(next, p_err / cnt));
             acc += p_err / cnt;
         }
     }
 
     assert(fabs(acc - 1.0) < 1.0e-6);
 
-    return allSuccessors->at(idAction);
+    return successors;
+}
+
+
+mlcore::SuccessorView
+RacetrackProblem::cachedSuccessors(RacetrackState* rts, RacetrackAction* rta)
+{
+    if (!rts->hasSuccessors()) {
+        mlcore::SuccessorView all = mlcore::SuccessorView::scratch();
+        unsigned char ends[9];
+        for (mlcore::Action* a : actions_) {
+            RacetrackAction* rtaA = static_cast<RacetrackAction*>(a);
+            if (applicable(rts, a)) {
+                mlcore::SuccessorView view = useFlatTransition_ ?
+                    flatActionSuccessors(rts, rtaA) :
+                    actionSuccessors(rts, rtaA);
+                for (const mlcore::Successor& su : view)
+                    all.push_back(su);
+            }
+            ends[rtaA->hashValue()] = all.size();
+        }
+        rts->cacheSuccessors(all, ends);
+    }
+    return rts->cachedSuccessors(rta->hashValue());
 }
 
 
@@ -223,34 +274,82 @@ bool RacetrackProblem::applicable(mlcore::State* s, mlcore::Action* a) const
 }
 
 
-RacetrackState*
-RacetrackProblem::resultingState(RacetrackState* rts, int ax, int ay)
+mlcore::State* RacetrackProblem::makeState(int x, int y, int vx, int vy)
 {
-    int x1 = rts->x(), y1 = rts->y();
-    int vx = rts->vx() + ax, vy = rts->vy() + ay;
+    uint64_t key[2];
+    unsigned keySize = RacetrackState::makeKey(x, y, vx, vy, key);
+    return this->addState(key, keySize, [&] {
+        return this->newState<RacetrackState>(x, y, vx, vy, this);
+    });
+}
 
+
+int RacetrackProblem::castRay(int x1, int y1, int vx, int vy) const
+{
     int m = 2 * (abs(vx) + abs(vy));
 
     if (m == 0)
-        return new RacetrackState(x1, y1, 0, 0, this);
+        return 0;
 
     for (int d = 0; d <= m; d++) {
         int x2 = round(x1 + (double) (d * vx) / m);
         int y2 = round(y1 + (double) (d * vy) / m);
         if (track_[x2][y2] == rtrack::wall ||
-                track_[x2][y2] == rtrack::pothole) {
-            return new RacetrackState(x2, y2, 0, 0, this);
+                track_[x2][y2] == rtrack::pothole ||
+                track_[x2][y2] == rtrack::goal) {
+            return d;
         }
-        if (track_[x2][y2] == rtrack::goal) {
-            return new RacetrackState(x2, y2, vx, vy, this);
+    }
+    return m;
+}
+
+
+uint32_t RacetrackProblem::rayCell(int x, int y, int vx, int vy)
+{
+    int m = 2 * (abs(vx) + abs(vy));
+    if (m == 0)
+        return x * rayStride_ + y;
+    int d;
+    if (abs(vx) > ray_speed || abs(vy) > ray_speed) {
+        d = castRay(x, y, vx, vy);
+    } else {
+        // Entry: 1 (valid) | cell (up to 30 bits) | vx, vy (5 bits each) |
+        // step (6 bits, at most 4 * ray_speed).
+        uint64_t key = (uint64_t(x * rayStride_ + y) << 10) |
+            ((vx + ray_speed) << 5) | (vy + ray_speed);
+        std::atomic<uint64_t>& entry =
+            rays_[mdplib::mix64(key) & (rays_.size() - 1)];
+        uint64_t stored = entry.load(std::memory_order_relaxed);
+        if (stored >> 6 == (key | uint64_t(1) << 57)) {
+            d = stored & 63;
+        } else {
+            d = castRay(x, y, vx, vy);
+            entry.store((key | uint64_t(1) << 57) << 6 | d,
+                        std::memory_order_relaxed);
         }
     }
-    return new RacetrackState(x1 + vx, y1 + vy, vx, vy, this);
+    int x2 = round(x + (double) (d * vx) / m);
+    int y2 = round(y + (double) (d * vy) / m);
+    return x2 * rayStride_ + y2;
 }
 
 
-std::list<mlcore::Successor>
-RacetrackProblem::flatTransition(mlcore::State* s, mlcore::Action* a)
+mlcore::State*
+RacetrackProblem::resultingState(RacetrackState* rts, int ax, int ay)
+{
+    int vx = rts->vx() + ax, vy = rts->vy() + ay;
+    uint32_t cell = rayCell(rts->x(), rts->y(), vx, vy);
+    int x2 = cell / rayStride_, y2 = cell % rayStride_;
+    // The car stops if it hits a wall or a pothole, and keeps its velocity
+    // if it reaches a goal or moves freely.
+    if (track_[x2][y2] == rtrack::wall || track_[x2][y2] == rtrack::pothole)
+        return makeState(x2, y2, 0, 0);
+    return makeState(x2, y2, vx, vy);
+}
+
+
+mlcore::SuccessorView
+RacetrackProblem::flatSuccessors(mlcore::State* s, mlcore::Action* a)
 {
     assert(applicable(s, a));
 
@@ -258,12 +357,10 @@ RacetrackProblem::flatTransition(mlcore::State* s, mlcore::Action* a)
     RacetrackAction* rta = static_cast<RacetrackAction*>(a);
 
     if (s == s0) {
-        std::list<mlcore::Successor> successors;
+        mlcore::SuccessorView successors = mlcore::SuccessorView::scratch();
         for (std::pair<int,int> start : starts_) {
-            mlcore::State* next =
-                new RacetrackState(start.first, start.second, 0, 0, this);
-            successors.push_back(mlcore::Successor(this->addState(next),
-                                 1.0 / starts_.size()));
+            mlcore::State* next = makeState(start.first, start.second, 0, 0);
+            successors.push_back(mlcore::Successor(next, 1.0 / starts_.size()));
         }
         return successors;
     }
@@ -271,7 +368,7 @@ RacetrackProblem::flatTransition(mlcore::State* s, mlcore::Action* a)
     int numSuccessors = numSuccessorsAction(rta);
 
     if (goal(s) || s == absorbing_) {
-        std::list<mlcore::Successor> successors;
+        mlcore::SuccessorView successors = mlcore::SuccessorView::scratch();
         for (int i = 0; i < numSuccessors; i++)
             successors.push_back(
                 mlcore::Successor(this->addState(absorbing_),
@@ -279,23 +376,26 @@ RacetrackProblem::flatTransition(mlcore::State* s, mlcore::Action* a)
         return successors;
     }
 
-    int idAction = rta->hashValue();
-    std::vector<mlcore::SuccessorsList>* allSuccessors = rts->allSuccessors();
-    if (!allSuccessors->at(idAction).empty()) {
-        return allSuccessors->at(idAction);
-    }
+    return cachedSuccessors(rts, rta);
+}
+
+
+mlcore::SuccessorView
+RacetrackProblem::flatActionSuccessors(RacetrackState* rts,
+                                       RacetrackAction* rta)
+{
+    int numSuccessors = numSuccessorsAction(rta);
+    mlcore::SuccessorView successors = mlcore::SuccessorView::scratch();
 
     /* At walls the car can deterministically move to the track again */
     if (track_[rts->x()][rts->y()] == rtrack::wall ||
             track_[rts->x()][rts->y()] == rtrack::pothole) {
         int x = rts->x(), y = rts->y();
         int ax = rta->ax(), ay = rta->ay();
-        mlcore::State* next =
-          this->addState(new RacetrackState(x + ax, y + ay, ax, ay, this));
+        mlcore::State* next = makeState(x + ax, y + ay, ax, ay);
         for (int i = 0; i < numSuccessors; i++)
-            allSuccessors->at(idAction).
-                push_back(mlcore::Successor(next, 1.0 / numSuccessors));
-        return allSuccessors->at(idAction);
+            successors.push_back(mlcore::Successor(next, 1.0 / numSuccessors));
+        return successors;
     }
 
     bool isDet = (abs(rts->vx()) + abs(rts->vy())) < mds_;
@@ -310,12 +410,12 @@ RacetrackProblem::flatTransition(mlcore::State* s, mlcore::Action* a)
     }
 
     double acc = 0.0;
-    mlcore::State* next = this->addState(resultingState(rts, 0, 0));
-    allSuccessors->at(idAction).push_back(mlcore::Successor(next, p_slip));
+    mlcore::State* next = resultingState(rts, 0, 0);
+    successors.push_back(mlcore::Successor(next, p_slip));
     acc += p_slip;
 
-    next = this->addState(resultingState(rts, rta->ax(), rta->ay()));
-    allSuccessors->at(idAction).push_back(mlcore::Successor(next, p_int));
+    next = resultingState(rts, rta->ax(), rta->ay());
+    successors.push_back(mlcore::Successor(next, p_int));
     acc += p_int;
 
     for (mlcore::Action* a2 : actions_) {
@@ -324,14 +424,14 @@ RacetrackProblem::flatTransition(mlcore::State* s, mlcore::Action* a)
             abs(rtaE->ax() - rta->ax()) + abs(rtaE->ay() - rta->ay());
         if (dist == 0 || dist > 1)
             continue;
-        next = this->addState(resultingState(rts, rtaE->ax(), rtaE->ay()));
-        allSuccessors->at(idAction).
-            push_back(mlcore::Successor(next, p_err / (numSuccessors - 2)));
+        next = resultingState(rts, rtaE->ax(), rtaE->ay());
+        successors.push_back(
+            mlcore::Successor(next, p_err / (numSuccessors - 2)));
         acc += p_err / (numSuccessors - 2);
     }
     assert(fabs(acc - 1.0) < 1.0e-6);
 
-    return allSuccessors->at(idAction);
+    return successors;
 }
 
 
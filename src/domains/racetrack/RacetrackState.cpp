@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cassert>
+
 #include "../../../include/domains/racetrack/RacetrackProblem.h"
 #include "../../../include/domains/racetrack/RacetrackState.h"
 #include "../../../include/domains/racetrack/RacetrackAction.h"
@@ -6,24 +9,35 @@
 RacetrackState::RacetrackState(int x, int y, int vx, int vy,
                                 mlcore::Problem* problem)
 {
-    x_ = x;
-    y_ = y;
-    vx_ = vx;
-    vy_ = vy;
+    assert(x == (int16_t) x && y == (int16_t) y &&
+           vx == (int16_t) vx && vy == (int16_t) vy);
+    makeKey(x, y, vx, vy, &key_);
     problem_ = problem;
 
-    /* Adding a successor entry for each action */
-    for (int i = 0; i < 9; i++) {
-        allSuccessors_.push_back(std::list<mlcore::Successor> ());
-    }
+    successors_.store(mdplib::no_index, std::memory_order_relaxed);
+    for (int i = 0; i < 9; i++)
+        ends_[i].store(0, std::memory_order_relaxed);
+}
+
+void RacetrackState::cacheSuccessors(const mlcore::SuccessorView& successors,
+                                     const unsigned char* ends)
+{
+    uint32_t offset;
+    mlcore::Successor* run = problem_->newSuccessors(successors.size(),
+                                                     &offset);
+    std::copy(successors.begin(), successors.end(), run);
+    for (int i = 0; i < 9; i++)
+        ends_[i].store(ends[i], std::memory_order_relaxed);
+    // Publishes the run and the ends after they have been written.
+    successors_.store(offset, std::memory_order_release);
 }
 
 std::ostream& RacetrackState::print(std::ostream& os) const
 {
     RacetrackProblem* rtp = static_cast<RacetrackProblem *> (problem_);
-    os << "(" << x_  << ", " << y_ << ", " << vx_ << ", " << vy_ << ", w";
-    if (x_ >= 0) {
-        if  (rtp->track()[x_][y_] == rtrack::wall)
+    os << "(" << x()  << ", " << y() << ", " << vx() << ", " << vy() << ", w";
+    if (x() >= 0) {
+        if  (rtp->track()[x()][y()] == rtrack::wall)
             os << "1";
         else
             os << "0";
@@ -38,10 +52,7 @@ mlcore::State& RacetrackState::operator=(const mlcore::State& rhs)
         return *this;
 
     const RacetrackState* state = static_cast<const RacetrackState *> (&rhs);
-    x_ = state->x_;
-    y_ = state->y_;
-    vx_ = state->vx_;
-    vy_ = state->vy_;
+    key_ = state->key_;
     problem_ = state->problem_;
     return *this;
 }
@@ -49,10 +60,7 @@ mlcore::State& RacetrackState::operator=(const mlcore::State& rhs)
 bool RacetrackState::operator==(const mlcore::State& rhs) const
 {
     const RacetrackState* state = static_cast<const RacetrackState *> (&rhs);
-    return x_ == state->x_
-            && y_ == state->y_
-            && vx_ == state->vx_
-            && vy_ == state->vy_;
+    return key_ == state->key_;
 }
 bool RacetrackState::equals(mlcore::State* other) const
 {
@@ -62,5 +70,11 @@ bool RacetrackState::equals(mlcore::State* other) const
 
 int RacetrackState::hashValue() const
 {
-    return x_ + 31 * (y_ + 31 * (vx_ + 31 * vy_));
+    return x() + 31 * (y() + 31 * (vx() + 31 * vy()));
+}
+
+unsigned RacetrackState::packKey(uint64_t* key, unsigned /* size */) const
+{
+    key[0] = key_;
+    return 1;
 }
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+
+#include "../../../include/domains/sailing/SailingDijkstraHeuristic.h"
+#include "../../../include/domains/sailing/SailingProblem.h"
+#include "../../../include/domains/sailing/SailingState.h"
+
+#include "../../../include/MDPLib.h"
+#include "../../../include/util/graph.h"
+
+SailingDijkstraHeuristic::SailingDijkstraHeuristic(SailingProblem* problem)
+{
+    int rows = problem->rows_;
+    cols_ = problem->cols_;
+    int cols = cols_;
+    short goalX = problem->goalX_, goalY = problem->goalY_;
+
+    std::vector< std::pair<uint32_t, double> > goals;
+    for (int wind = 0; wind < 8; wind++)
+        goals.push_back(std::make_pair((goalX * cols + goalY) * 8 + wind, 0.0));
+
+    // State (x, y, wind) is reached by sailing in direction a from
+    // (x - dx[a], y - dy[a], w), for any wind w that can change to wind,
+    // unless a is into w. The goal can't be left.
+    static const short dx[] = {0, 1, 1,  1,  0, -1, -1, -1};
+    static const short dy[] = {1, 1, 0, -1, -1, -1,  0,  1};
+    costs_ = reverseDijkstra(
+        uint32_t(rows) * cols * 8, goals,
+        [&] (uint32_t v, std::vector< std::pair<uint32_t, double> >& edges) {
+            int wind = v % 8, x = v / 8 / cols, y = v / 8 % cols;
+            for (int a = 0; a < 8; a++) {
+                int ux = x - dx[a], uy = y - dy[a];
+                if (!problem->inLake(ux, uy) || (ux == goalX && uy == goalY))
+                    continue;
+                for (int w = 0; w < 8; w++) {
+                    if (problem->windTransition_[8 * w + wind] <= 0.0)
+                        continue;
+                    int d = std::abs(a - w);
+                    int tack = std::min(d, 8 - d);
+                    if (tack == INTO)
+                        continue;
+                    edges.push_back(std::make_pair(
+                        uint32_t((ux * cols + uy) * 8 + w),
+                        problem->costs_[tack]));
+                }
+            }
+        });
+}
+
+
+double SailingDijkstraHeuristic::cost(const mlcore::State* s)
+{
+    const SailingState* state = static_cast<const SailingState*> (s);
+    if (state->x() < 0)   // absorbing state
+        return 0.0;
+    return std::min(costs_[(size_t(state->x()) * cols_ + state->y()) * 8 +
+                           state->wind()],
+                    mdplib::dead_end_cost);
+}
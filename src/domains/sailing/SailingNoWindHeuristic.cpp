@@ -13,7 +13,6 @@
 SailingNoWindHeuristic::SailingNoWindHeuristic(SailingProblem* problem)
 {
     problem_ = problem;
-    tmp_ = new SailingState(-2, -2, -2, problem_);
 }
 
 double SailingNoWindHeuristic::cost(const mlcore::State* s)
@@ -26,13 +25,12 @@ double SailingNoWindHeuristic::cost(const mlcore::State* s)
 
     int x = state->x_;
     int y = state->y_;
-    tmp_->x_ = x;
-    tmp_->y_ = y;
-    tmp_->wind_ = state->wind_;
+    // A local copy, so that the heuristic can be called from several threads.
+    SailingState tmp(x, y, state->wind_, problem_);
     double heuristicValue = mdplib::dead_end_cost + 1;
     for (mlcore::Action* a : problem_->actions()) {
         SailingAction* sa = static_cast<SailingAction*> (a);
-        double cost = problem_->cost(tmp_, a);
+        double cost = problem_->cost(&tmp, a);
         short dx[] = {0, 1, 1,  1,  0, -1, -1, -1};
         short dy[] = {1, 1, 0, -1, -1, -1,  0,  1};
         short nextX = (short) (x + dx[sa->dir()]);
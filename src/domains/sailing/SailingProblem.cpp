@@ -31,6 +31,8 @@ SailingProblem::SailingProblem(short startX, short startY,
         mlcore::Action* a = new SailingAction(i);
         actions_.push_back(a);
     }
+
+    cacheSamplers_ = true;
 }
 
 
@@ -60,7 +62,15 @@ bool SailingProblem::goal(mlcore::State* s) const
 std::list<mlcore::Successor>
 SailingProblem::transition(mlcore::State* s, mlcore::Action* a)
 {
-    std::list<mlcore::Successor> successors;
+    mlcore::SuccessorView view = successors(s, a);
+    return std::list<mlcore::Successor>(view.begin(), view.end());
+}
+
+
+mlcore::SuccessorView
+SailingProblem::successors(mlcore::State* s, mlcore::Action* a)
+{
+    mlcore::SuccessorView successors = mlcore::SuccessorView::scratch();
 
     if (goal(s) || s == absorbing_) {
         if (useFlatTransition_)
@@ -85,10 +95,13 @@ SailingProblem::transition(mlcore::State* s, mlcore::Action* a)
             for (short nextWind = 0; nextWind < 8; nextWind++) {
                 double p = windTransition_[8 * state->wind() + nextWind];
                 if (p > 0.0 || useFlatTransition_) {
-                    mlcore::State* next =
-                        new SailingState(nextX, nextY, nextWind, this);
-                    successors.push_back(
-                        mlcore::Successor(this->addState(next), p));
+                    uint64_t key =
+                        SailingState::makeKey(nextX, nextY, nextWind);
+                    mlcore::State* next = this->addState(&key, 1, [&] {
+                        return this->newState<SailingState>(
+                            nextX, nextY, nextWind, this);
+                    });
+                    successors.push_back(mlcore::Successor(next, p));
                 }
             }
         } else {
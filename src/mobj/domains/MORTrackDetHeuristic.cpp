@@ -27,7 +27,7 @@ double MORTrackDetHeuristic::cost(const mlcore::State* s)
     MORacetrackState* rts = (MORacetrackState*) s;
     MORacetrackState* tmp =
         new MORacetrackState(rts->x(), rts->y(), rts->vx(), rts->vy(), rts->safe(), detProblem_);
-    mlcore::StateSet::const_iterator it = detProblem_->states().find((mlcore::State *) tmp);
+    mlcore::StateTable::const_iterator it = detProblem_->states().find((mlcore::State *) tmp);
     assert(it != detProblem_->states().end());
     delete tmp;
     return (*it)->cost();
@@ -4,6 +4,7 @@
 
 #include "../../include/solvers/LAOStarSolver.h"
 #include "../../include/solvers/VISolver.h"
+#include "../../include/util/parallel.h"
 
 #include "../../include/reduced/ReducedHeuristicWrapper.h"
 #include "../../include/reduced/ReducedModel.h"
@@ -15,6 +16,16 @@ using namespace mlcore;
 namespace mlreduced
 {
 
+State* ReducedModel::reducedState(State* originalState, int exceptionCount)
+{
+    uint64_t key[2];
+    unsigned keySize =
+        ReducedState::makeKey(originalState, exceptionCount, key);
+    return addState(key, keySize, [&] {
+        return newState<ReducedState>(originalState, exceptionCount, this);
+    });
+}
+
 std::list<Successor>
 ReducedModel::transition(State* s, Action* a) {
     ReducedState* rs = static_cast<ReducedState*>(s);
@@ -31,8 +42,7 @@ ReducedModel::transition(State* s, Action* a) {
     // possible, just use the same transition w/o increasing the counter.
     if (originalSuccessors.size() == 1) {
         Successor const & origSucc = originalSuccessors.back();
-        State* next = addState(
-            new ReducedState(origSucc.su_state, rs->exceptionCount(), this));
+        State* next = reducedState(origSucc.su_state, rs->exceptionCount());
         successors.push_back(Successor(next, 1.0));
         return successors;
     }
@@ -51,16 +61,13 @@ ReducedModel::transition(State* s, Action* a) {
                 next_k = this->k_;    // Simulates re-planning policy
             else
                 next_k -= int(!isPrimaryOutcome);
-            next = addState(new ReducedState(origSucc.su_state, next_k, this));
+            next = reducedState(origSucc.su_state, next_k);
         } else {
             if (isPrimaryOutcome) {
-                next = addState(new ReducedState(origSucc.su_state,
-                                                 rs->exceptionCount(),
-                                                 this));
+                next = reducedState(origSucc.su_state, rs->exceptionCount());
             } else if (rs->exceptionCount() > 0) {
-                next = addState(new ReducedState(origSucc.su_state,
-                                                 rs->exceptionCount() - 1,
-                                                 this));
+                next = reducedState(origSucc.su_state,
+                                    rs->exceptionCount() - 1);
             }
         }
         if (next != nullptr) {
@@ -99,12 +106,15 @@ double ReducedModel::evaluateMarkovChain(ReducedModel* reducedModel) {
             }
             // We need to add a copy also in the reduced model, because some
             // of these states might be unreachable from its initial state.
-            State* aux = reducedModel->addState(
-                new ReducedState(rs->originalState(), j, reducedModel));
+            reducedModel->reducedState(rs->originalState(), j);
         }
     }
 
-    bool safe = mlsolvers::testDeadEnds(reducedModel);
+    // The reduced model is frozen from here on, so the dead-end test and
+    // the universal plan below run on a compiled snapshot of it.
+    reducedModel->generateAll();
+    mlcore::CompiledProblem compiledModel(reducedModel);
+    bool safe = mlsolvers::testDeadEnds(compiledModel);
     if (!safe) {
         return mdplib::dead_end_cost;
     }
@@ -115,7 +125,8 @@ double ReducedModel::evaluateMarkovChain(ReducedModel* reducedModel) {
 //                                                                                }
 
     // Computing an universal plan for all of these states in the reduced model.
-    mlsolvers::VISolver solver(reducedModel, 1000000, 1.0e-3);
+    mlsolvers::VISolver solver(&compiledModel, 1000000, 1.0e-3);
+    solver.numThreads(hardwareThreads());
     solver.solve();
 //                                                                                for (mlcore::State* sss : reducedModel->states()) {
 ////                                                                                    dprint(sss, heur.at(sss), sss->cost());
@@ -138,11 +149,9 @@ double ReducedModel::evaluateMarkovChain(ReducedModel* reducedModel) {
             ReducedState* markovChainState = static_cast<ReducedState*>(s);
             // currentState is the state that markovChainState represents in
             // the reduced model.
-            State* currentState =
-                reducedModel->addState(
-                    new ReducedState(markovChainState->originalState(),
-                                     markovChainState->exceptionCount(),
-                                     reducedModel));
+            State* currentState = reducedModel->reducedState(
+                markovChainState->originalState(),
+                markovChainState->exceptionCount());
 
             if (currentState->deadEnd()) {
                 // state->deadEnd is set by the solver when there is no
@@ -179,22 +188,32 @@ ReducedTransition* ReducedModel::getBestReduction(
         ReducedHeuristicWrapper* heuristic) {
     double bestCost = mdplib::dead_end_cost + 1;
     ReducedTransition* bestReduction = nullptr;
+    // A single model is used for all reductions, so that the states of
+    // each evaluation reuse the memory of the previous one.
+    ReducedModel reducedModel(originalProblem, nullptr, k);
+    reducedModel.setHeuristic(heuristic);
     for (ReducedTransition* reducedTransition : reducedTransitions) {
-        ReducedModel reducedModel(originalProblem, reducedTransition, k);
-        reducedModel.setHeuristic(heuristic);
+        reducedModel.reset(reducedTransition);
         double expectedCostReduction = reducedModel.evaluateMonteCarlo(100);
         if (expectedCostReduction < bestCost) {
             bestCost = expectedCostReduction;
             bestReduction = reducedTransition;
         }
-        for (State* s : reducedModel.states())
-            s->reset();     // make sure stored values are cleared.
-        reducedModel.cleanup();
     }
+    reducedModel.cleanup();
     return bestReduction;
 }
 
 
+void ReducedModel::reset(ReducedTransition* reducedTransition)
+{
+    clearStates();
+    reducedTransition_ = reducedTransition;
+    useFullTransition_ = reducedTransition_ == nullptr;
+    s0 = reducedState(originalProblem_->initialState(), k_);
+}
+
+
 double ReducedModel::evaluateMonteCarlo(int numTrials) {
     WrapperProblem wrapper(this);
     mlsolvers::LAOStarSolver solver(static_cast<Problem*>(&wrapper));
@@ -448,9 +467,11 @@ ReducedModel::trialAnytime(mlsolvers::Solver & solver,
             int k_reduced = this->k_;
 //                                                                                dprint(currentState);
             while (true) {
+                uint64_t key[2];
+                unsigned keySize = ReducedState::makeKey(
+                    currentState->originalState(), k_reduced, key);
                 ReducedState* auxState = static_cast<ReducedState*> (
-                    this->getState(new ReducedState(
-                        currentState->originalState(), k_reduced, this)));
+                    this->getState(key, keySize));
                 if (auxState == nullptr) {
                     // The state has never seen before with counter [k_reduced]
                     // Note that to reach counter [k_reduced], the state with
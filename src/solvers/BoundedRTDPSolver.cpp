@@ -60,7 +60,7 @@ mlcore::State* BoundedRTDPSolver::sampleBiased(
         mlcore::State* s, mlcore::Action* a, mlcore::State* s0) {
     double B = 0.0;
     std::vector< std::pair<mlcore::State*, double> > statesAndScores;
-    for (const mlcore::Successor& su : problem_->transition(s, a)) {
+    for (const mlcore::Successor& su : problem_->successors(s, a)) {
         double score =
             su.su_prob * (upperBounds_.at(su.su_state) - su.su_state->cost());
         statesAndScores.push_back(std::make_pair(su.su_state, score));
@@ -69,7 +69,7 @@ mlcore::State* BoundedRTDPSolver::sampleBiased(
     if ((upperBounds_.at(s) - s->cost()) == 0
             || B < (upperBounds_.at(s0) - s0->cost()) / tau_)
         return nullptr;
-    double pick = kUnif_0_1(kRNG);
+    double pick = threadRNG().uniform();
     double acc = 0;
     for (auto stateAndScore : statesAndScores) {
         acc += stateAndScore.second / B;
@@ -11,7 +11,14 @@ namespace mlsolvers
     void ConcurrentSolver::runSolver() const
     {
         while (keepRunning_) {
-            solver_.solve(state_);
+            {
+                std::lock_guard<std::mutex> lock(bellman_mutex);
+                if (!keepRunning_)
+                    break;
+                solver_.solve(state_);
+            }
+            // Lets a waiting execution thread take the lock.
+            std::this_thread::yield();
         }
     }
 
@@ -80,7 +80,7 @@ bool FLARESSolver::labeledSolved(State* s)
 }
 
 
-double FLARESSolver::computeNewDepth(Successor& su, double depth)
+double FLARESSolver::computeNewDepth(const Successor& su, double depth)
 {
     if (useProbsForDepth_) {
         return depth + log(su.su_prob);
@@ -128,7 +128,7 @@ bool FLARESSolver::checkSolved(State* s)
             rv = false;
         }
 
-        for (Successor su : problem_->transition(currentState, a)) {
+        for (const Successor& su : problem_->successors(currentState, a)) {
             State* next = su.su_state;
             if (!labeledSolved(next) &&
                     !next->checkBits(mdplib::CLOSED)) {
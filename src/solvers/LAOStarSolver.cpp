@@ -16,7 +16,7 @@ mlcore::Action* LAOStarSolver::solve(mlcore::State* s0)
     double error = mdplib::dead_end_cost;
     while (true) {
         do {
-            visited.clear();
+            visitEpoch_ = mlcore::State::newVisitEpoch();
             countExpanded = expand(s0);
             totalExpanded += countExpanded;
             if ((0.001 * (clock() - startTime)) /
@@ -30,7 +30,7 @@ mlcore::Action* LAOStarSolver::solve(mlcore::State* s0)
                     CLOCKS_PER_SEC > timeLimit_)
                 return s0->bestAction();
 
-            visited.clear();
+            visitEpoch_ = mlcore::State::newVisitEpoch();
             error = testConvergence(s0);
             if (error < epsilon_)
                 return s0->bestAction();
@@ -43,7 +43,7 @@ mlcore::Action* LAOStarSolver::solve(mlcore::State* s0)
 
 int LAOStarSolver::expand(mlcore::State* s)
 {
-    if (!visited.insert(s).second)  // state was already visited.
+    if (!s->markVisited(visitEpoch_))  // state was already visited.
         return 0;
     if (s->deadEnd() || problem_->goal(s))
         return 0;
@@ -69,7 +69,7 @@ double LAOStarSolver::testConvergence(mlcore::State* s)
     if (s->deadEnd() || problem_->goal(s))
         return 0.0;
 
-    if (!visited.insert(s).second)
+    if (!s->markVisited(visitEpoch_))
         return 0.0;
 
     mlcore::Action* prevAction = s->bestAction();
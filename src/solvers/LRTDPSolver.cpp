@@ -1,5 +1,7 @@
 #include "../../include/solvers/LRTDPSolver.h"
 
+#include "../../include/util/parallel.h"
+
 namespace mlsolvers
 {
 
@@ -12,7 +14,9 @@ LRTDPSolver::LRTDPSolver(mlcore::Problem* problem,
     maxTrials_(maxTrials),
     epsilon_(epsilon),
     maxTime_(maxTime),
-    dont_label_(dont_label)
+    dont_label_(dont_label),
+    numThreads_(1),
+    trials_(0)
 { }
 
 
@@ -27,7 +31,7 @@ bool LRTDPSolver::ranOutOfTime() {
     return false;
 }
 
-void LRTDPSolver::trial(mlcore::State* s) {
+void LRTDPSolver::trial(mlcore::State* s, mdplib::Rng& rng, Worker* worker) {
     mlcore::State* tmp = s;
     std::list<mlcore::State*> visited;
     double accumulated_cost = 0.0;
@@ -42,8 +46,9 @@ void LRTDPSolver::trial(mlcore::State* s) {
         if (tmp->deadEnd())
             break;
 
-        accumulated_cost += problem_->cost(tmp, tmp->bestAction());
-        tmp = randomSuccessor(problem_, tmp, tmp->bestAction());
+        mlcore::Action* a = tmp->bestAction();
+        accumulated_cost += problem_->cost(tmp, a);
+        tmp = randomSuccessor(problem_, tmp, a, rng);
     }
 
     if (dont_label_)
@@ -52,16 +57,28 @@ void LRTDPSolver::trial(mlcore::State* s) {
     while (!visited.empty()) {
         tmp = visited.front();
         visited.pop_front();
-        bool solved = checkSolved(tmp);
+        bool solved = checkSolved(tmp, worker);
         if (!solved) break;
     }
 }
 
 
-bool LRTDPSolver::checkSolved(mlcore::State* s)
+bool LRTDPSolver::checkSolved(mlcore::State* s, Worker* worker)
 {
     std::list<mlcore::State*> open, closed;
 
+    if (worker != nullptr && ++worker->stamp == 0) {
+        std::fill(worker->closed.begin(), worker->closed.end(), 0);
+        worker->stamp = 1;
+    }
+    auto isClosed = [worker] (mlcore::State* state) {
+        if (worker == nullptr)
+            return state->checkBits(mdplib::CLOSED);
+        uint32_t idx = state->index();
+        return idx < worker->closed.size() &&
+            worker->closed[idx] == worker->stamp;
+    };
+
     mlcore::State* tmp = s;
     if (!tmp->checkBits(mdplib::SOLVED)) {
         open.push_front(s);
@@ -84,7 +101,16 @@ bool LRTDPSolver::checkSolved(mlcore::State* s)
             return false;
 
         closed.push_front(tmp);
-        tmp->setBits(mdplib::CLOSED);
+        if (worker == nullptr) {
+            tmp->setBits(mdplib::CLOSED);
+        } else {
+            uint32_t idx = tmp->index();
+            if (idx >= worker->closed.size()) {
+                worker->closed.resize(
+                    std::max<size_t>(idx + 1, 2 * worker->closed.size()), 0);
+            }
+            worker->closed[idx] = worker->stamp;
+        }
 
         if (residual(problem_, tmp) > epsilon_) {
             rv = false;
@@ -93,10 +119,9 @@ bool LRTDPSolver::checkSolved(mlcore::State* s)
             /*  continue; */
         }
 
-        for (mlcore::Successor su : problem_->transition(tmp, a)) {
+        for (const mlcore::Successor& su : problem_->successors(tmp, a)) {
             mlcore::State* next = su.su_state;
-            if (!next->checkBits(mdplib::SOLVED) &&
-                !next->checkBits(mdplib::CLOSED)) {
+            if (!next->checkBits(mdplib::SOLVED) && !isClosed(next)) {
                 open.push_front(next);
             }
         }
@@ -104,15 +129,20 @@ bool LRTDPSolver::checkSolved(mlcore::State* s)
 
     if (rv) {
         for (mlcore::State* sc : closed) {
-            sc->setBits(mdplib::SOLVED);
-            sc->clearBits(mdplib::CLOSED);
             sc->setBestAction(greedyAction(problem_, sc));
+            if (worker == nullptr) {
+                sc->setBits(mdplib::SOLVED);
+                sc->clearBits(mdplib::CLOSED);
+            } else {
+                sc->setBitsAtomic(mdplib::SOLVED);
+            }
         }
     } else {
         while (!closed.empty()) {
             tmp = closed.front();
             closed.pop_front();
-            tmp->clearBits(mdplib::CLOSED);
+            if (worker == nullptr)
+                tmp->clearBits(mdplib::CLOSED);
             bellmanUpdate(problem_, tmp);
             if (ranOutOfTime())
                 return false;
@@ -123,18 +153,40 @@ bool LRTDPSolver::checkSolved(mlcore::State* s)
 }
 
 
+void LRTDPSolver::runTrials(mlcore::State* s0, Worker* worker)
+{
+    mdplib::Rng rng;
+    int i;
+    while (!s0->checkBits(mdplib::SOLVED) && (i = trials_++) < maxTrials_) {
+        rng.seed(rngSeed(), firstStream_ + i);
+        trial(s0, rng, worker);
+        if (ranOutOfTime())
+            return;
+    }
+}
+
+
 mlcore::Action* LRTDPSolver::solve(mlcore::State* s0)
 {
-    int trials = 0;
+    trials_ = 0;
+    firstStream_ = reserveRNGStreams(std::max(maxTrials_, 0));
     beginTime_ = std::chrono::high_resolution_clock::now();
-    while (!s0->checkBits(mdplib::SOLVED) && trials++ < maxTrials_) {
-        trial(s0);
-        if (ranOutOfTime()) {
-            return greedyAction(problem_, s0);
-        }
+    // The value store is not safe to grow from several threads.
+    if (numThreads_ == 1 || problem_->valueStore() != nullptr) {
+        runTrials(s0, nullptr);
+    } else {
+        std::vector<Worker> workers(numThreads_);
+        bool concurrentStates = problem_->concurrentStates();
+        problem_->concurrentStates(true);
+        runThreads(numThreads_, [&] (int t) {
+            runTrials(s0, &workers[t]);
+        });
+        problem_->concurrentStates(concurrentStates);
+    }
+    if (ranOutOfTime()) {
+        return greedyAction(problem_, s0);
     }
     return s0->bestAction();
 }
 
 }
-
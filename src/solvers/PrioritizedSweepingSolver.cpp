@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "../../include/solvers/PrioritizedSweepingSolver.h"
+#include "../../include/solvers/Solver.h"
+#include "../../include/util/heap.h"
+
+namespace mlsolvers
+{
+
+PrioritizedSweepingSolver::PrioritizedSweepingSolver(mlcore::Problem* problem,
+                                                     long maxBackups,
+                                                     double tol)
+{
+    problem_ = problem;
+    maxBackups_ = maxBackups;
+    tol_ = tol;
+    maxTime_ = -1;
+    backups_ = 0;
+}
+
+
+mlcore::Action* PrioritizedSweepingSolver::solve(mlcore::State* /* s0 */)
+{
+    auto beginTime = std::chrono::high_resolution_clock::now();
+    if (!problem_->hasPredecessors())
+        problem_->generateAll(true);
+    // The solver updates the state objects directly.
+    problem_->syncValueStore();
+
+    // The number of steps from each state to the closest goal, found with a
+    // backward breadth-first search over the predecessor index.
+    uint32_t n = problem_->numStates();
+    std::vector<uint32_t> distance(n, UINT32_MAX);
+    std::vector<uint32_t> queue;
+    for (uint32_t i = 0; i < n; i++) {
+        if (problem_->goal(problem_->stateAt(i))) {
+            distance[i] = 0;
+            queue.push_back(i);
+        }
+    }
+    for (size_t q = 0; q < queue.size(); q++) {
+        std::pair<const uint32_t*, const uint32_t*> preds =
+            problem_->predecessors(problem_->stateAt(queue[q]));
+        for (const uint32_t* j = preds.first; j != preds.second; j++) {
+            if (distance[*j] == UINT32_MAX) {
+                distance[*j] = distance[queue[q]] + 1;
+                queue.push_back(*j);
+            }
+        }
+    }
+
+    // bound[i] estimates the Bellman residual of state i. It is exact after
+    // a pass over all states, and set to 0 when the state is backed up. A
+    // change of d in the value of a state changes the Q-values of a
+    // predecessor by at most gamma * p * d, where p is the largest
+    // probability of reaching the state from the predecessor, and the bound
+    // of the predecessor is raised to that amount.
+    //
+    // The states whose bound reaches the tolerance are backed up in rounds,
+    // in order of distance to the goals, so that changes are propagated
+    // away from the goals within a round. A predecessor closer to the goals
+    // than the state that changed, or already backed up, waits for the next
+    // round. Since the bounds are not upper bounds (small changes are not
+    // added up), the solver stops only after a pass over all states finds
+    // no residual above the tolerance, which is the same stopping test
+    // used by VISolver.
+    std::vector<double> bound(n, 0.0);
+    IndexedMaxHeap round(n), nextRound(n);
+    backups_ = 0;
+    bool stop = false;
+    while (!stop && backups_ < maxBackups_) {
+        for (uint32_t i = 0; i < n; i++) {
+            mlcore::State* s = problem_->stateAt(i);
+            if (problem_->goal(s))
+                continue;
+            std::pair<double, mlcore::Action*> best =
+                bellmanBackup(problem_, s);
+            s->setBestAction(best.bb_action);
+            bound[i] = fabs(best.bb_cost - s->cost());
+            backups_++;
+            if (bound[i] >= tol_)
+                round.push(i, -double(distance[i]));
+        }
+        if (round.empty())
+            break;
+
+        while (!round.empty()) {
+            uint32_t i = round.pop();
+            mlcore::State* s = problem_->stateAt(i);
+            std::pair<double, mlcore::Action*> best =
+                bellmanBackup(problem_, s);
+            double change = fabs(best.bb_cost - s->cost());
+            s->setCost(best.bb_cost);
+            s->setBestAction(best.bb_action);
+            bound[i] = 0.0;
+            backups_++;
+
+            if (change > 0.0) {
+                std::pair<const uint32_t*, const uint32_t*> preds =
+                    problem_->predecessors(s);
+                const double* probs = problem_->predecessorProbs(s);
+                for (uint32_t k = 0; preds.first + k != preds.second; k++) {
+                    uint32_t j = preds.first[k];
+                    if (problem_->goal(problem_->stateAt(j)))
+                        continue;
+                    bound[j] = std::max(bound[j],
+                                        problem_->gamma() * probs[k] * change);
+                    if (bound[j] < tol_)
+                        continue;
+                    if (distance[j] > distance[i] && !nextRound.contains(j))
+                        round.push(j, -double(distance[j]));
+                    else if (!round.contains(j))
+                        nextRound.push(j, -double(distance[j]));
+                }
+            }
+            if (round.empty())
+                std::swap(round, nextRound);
+
+            if (backups_ >= maxBackups_) {
+                stop = true;
+                break;
+            }
+            if (maxTime_ > -1 && backups_ % 1024 == 0) {
+                auto endTime = std::chrono::high_resolution_clock::now();
+                auto timeElapsed = std::chrono::duration_cast<
+                    std::chrono::milliseconds>(endTime - beginTime).count();
+                if (timeElapsed > maxTime_) {
+                    stop = true;
+                    break;
+                }
+            }
+        }
+    }
+    problem_->reloadValueStore();
+    return nullptr;
+}
+
+}
@@ -141,7 +141,7 @@ void RFFSolver::pickRandomStates(mlcore::StateSet& states,
     list<size_t> pickedIdx;
     for (size_t pickedCnt = 0; pickedCnt < n; pickedCnt++) {
         size_t pick =
-            static_cast<size_t> (rand() % (states.size() - pickedCnt));
+            threadRNG().below(states.size() - pickedCnt);
         for (int idx : pickedIdx) {
             if (pick < idx)
                 break;
@@ -206,11 +206,11 @@ void SSiPPSolver::optimalSolver(WrapperProblem* problem, State* s0)
     // This is a stack based implementation of LAO*.
     // We don't use the existing library implementation so that we can take
     // advantage of the SOLVED_SSiPP labels.
-    StateSet visited;
+    uint32_t epoch;
     int countExpanded = 0;
     while (true) {
         do {
-            visited.clear();
+            epoch = State::newVisitEpoch();
             countExpanded = 0;
             list<State*> stateStack;
             stateStack.push_back(s0);
@@ -220,7 +220,7 @@ void SSiPPSolver::optimalSolver(WrapperProblem* problem, State* s0)
                 }
                 State* s = stateStack.back();
                 stateStack.pop_back();
-                if (!visited.insert(s).second)  // state was already visited.
+                if (!s->markVisited(epoch))  // state was already visited.
                     continue;
 
                 if (s->deadEnd() ||
@@ -245,7 +245,7 @@ void SSiPPSolver::optimalSolver(WrapperProblem* problem, State* s0)
             }
         } while (countExpanded != 0);
         while (true) {
-            visited.clear();
+            epoch = State::newVisitEpoch();
             list<State*> stateStack;
             stateStack.push_back(s0);
             double error = 0.0;
@@ -260,7 +260,7 @@ void SSiPPSolver::optimalSolver(WrapperProblem* problem, State* s0)
                         s->checkBits(mdplib::SOLVED_SSiPP ||
                         problem->overrideGoals()->count(s) > 0))
                     continue;
-                if (!visited.insert(s).second)
+                if (!s->markVisited(epoch))
                     continue;
                 Action* prevAction = s->bestAction();
                 if (prevAction == nullptr) {
@@ -161,10 +161,12 @@ mlcore::State* SoftFLARESSolver::sampleSuccessor(mlcore::State* s,
     if (a == nullptr)
         return s;
 
-    double pick = kUnif_0_1(kRNG);
+    double pick = threadRNG().uniform();
     double acc = 0.0;
     int index = 0;
-    for (mlcore::Successor sccr : problem_->transition(s, a)) {
+    // The weights depend on the labels, so the problem's cached samplers
+    // can't be used here.
+    for (const mlcore::Successor& sccr : problem_->successors(s, a)) {
         double p = computeProbUnlabeled(sccr.su_state) * sccr.su_prob;
         acc += p;
         if (acc >= pick) {
@@ -177,7 +179,7 @@ mlcore::State* SoftFLARESSolver::sampleSuccessor(mlcore::State* s,
 bool SoftFLARESSolver::labeledSolved(State* s) {
     if (s->checkBits(mdplib::SOLVED))
         return true;
-    bool labeled = (kUnif_0_1(kRNG) > computeProbUnlabeled(s));
+    bool labeled = (threadRNG().uniform() > computeProbUnlabeled(s));
     return labeled;
 }
 
@@ -186,7 +188,7 @@ double SoftFLARESSolver::sampleEffectiveHorizon() {
         return horizon_;
     }
     if (horizonFunction_ == kBernoulli) {
-        if (kUnif_0_1(kRNG) > psi_) {
+        if (threadRNG().uniform() > psi_) {
             return horizon_;
         } else {
             return kInfiniteDistance_;
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <cassert>
 #include <list>
 
@@ -9,26 +10,79 @@ std::mutex bellman_mutex;
 
 std::random_device rand_dev;
 
-std::mt19937 kRNG(1234);
+namespace
+{
+std::atomic<uint64_t> rng_seed(1234);
+
+std::atomic<uint64_t> next_rng_stream(0);
+
+thread_local bool thread_rng_seeded = false;
+
+thread_local mdplib::Rng thread_rng;
+}
+
 
-std::uniform_real_distribution<> kUnif_0_1(0, 1);
+void seedRNG(uint64_t seed)
+{
+    rng_seed = seed;
+    next_rng_stream = 0;
+    thread_rng.seed(seed, reserveRNGStreams(1));
+    thread_rng_seeded = true;
+}
+
+
+uint64_t rngSeed()
+{
+    return rng_seed;
+}
+
+
+uint64_t reserveRNGStreams(uint64_t n)
+{
+    return next_rng_stream.fetch_add(n);
+}
+
+
+mdplib::Rng& threadRNG()
+{
+    if (!thread_rng_seeded) {
+        thread_rng.seed(rng_seed, reserveRNGStreams(1));
+        thread_rng_seeded = true;
+    }
+    return thread_rng;
+}
 
 
 double qvalue(mlcore::Problem* problem, mlcore::State* s, mlcore::Action* a)
 {
     double qAction = 0.0;
-    for (const mlcore::Successor& su : problem->transition(s, a)) {
+    for (const mlcore::Successor& su : problem->successors(s, a)) {
         qAction += su.su_prob * su.su_state->cost();
     }
     qAction = (qAction * problem->gamma()) + problem->cost(s, a);
     return qAction;
 }
 
+/*
+ * Computes the Q-value of the i-th action of the given expansion.
+ */
+static double qvalue(mlcore::Problem* problem,
+                     const mlcore::Expansion& expansion,
+                     size_t i)
+{
+    double qAction = 0.0;
+    for (const mlcore::Successor& su : expansion.successors(i)) {
+        qAction += su.su_prob * su.su_state->cost();
+    }
+    return (qAction * problem->gamma()) + expansion.cost(i);
+}
+
+
 std::pair<double, double>
 weightedQvalue(mlcore::Problem* problem, mlcore::State* s, mlcore::Action* a)
 {
     double g = 0.0, h = 0.0;
-    for (const mlcore::Successor& su : problem->transition(s, a)) {
+    for (const mlcore::Successor& su : problem->successors(s, a)) {
         g += su.su_prob * su.su_state->gValue();
         h += su.su_prob * su.su_state->hValue();
     }
@@ -42,34 +96,70 @@ std::pair<double, mlcore::Action*> bellmanBackup(mlcore::Problem* problem,
                                                  mlcore::State* s)
 {
     double bestQ = problem->goal(s) ? 0.0 : mdplib::dead_end_cost;
-    bool hasAction = false;
     mlcore::Action* bestAction = nullptr;
-    for (mlcore::Action* a : problem->actions()) {
-        if (!problem->applicable(s, a))
-            continue;
-        hasAction = true;
-        double qAction = std::min(mdplib::dead_end_cost, qvalue(problem, s, a));
+    mlcore::Expansion expansion = problem->expand(s);
+    for (size_t i = 0; i < expansion.size(); i++) {
+        double qAction =
+            std::min(mdplib::dead_end_cost, qvalue(problem, expansion, i));
         if (qAction <= bestQ) {
             bestQ = qAction;
-            bestAction = a;
+            bestAction = expansion.action(i);
         }
     }
 
-    if (!hasAction && bestQ >= mdplib::dead_end_cost)
+    if (expansion.empty() && bestQ >= mdplib::dead_end_cost)
         s->markDeadEnd();
 
     return std::make_pair(bestQ, bestAction);
 }
 
 
+/*
+ * Performs a Bellman update of a state reading and writing the values in the
+ * given value store instead of the state objects.
+ */
+static double bellmanUpdate(mlcore::Problem* problem,
+                            mlcore::ValueStore* values,
+                            mlcore::State* s)
+{
+    uint32_t idx = s->index();
+    double bestQ = problem->goal(s) ? 0.0 : mdplib::dead_end_cost;
+    mlcore::Action* bestAction = nullptr;
+    mlcore::Expansion expansion = problem->expand(s);
+    for (size_t i = 0; i < expansion.size(); i++) {
+        double qAction = 0.0;
+        for (const mlcore::Successor& su : expansion.successors(i)) {
+            uint32_t idxNext = su.su_state->index();
+            qAction += su.su_prob * (idxNext < values->size() ?
+                values->cost(idxNext) : su.su_state->cost());
+        }
+        qAction = (qAction * problem->gamma()) + expansion.cost(i);
+        qAction = std::min(mdplib::dead_end_cost, qAction);
+        if (qAction <= bestQ) {
+            bestQ = qAction;
+            bestAction = expansion.action(i);
+        }
+    }
+
+    if (expansion.empty() && bestQ >= mdplib::dead_end_cost)
+        values->markDeadEnd(idx);
+
+    double residual = values->cost(idx) - bestQ;
+    values->setCost(idx, bestQ);
+    values->setBestAction(idx, bestAction);
+    return fabs(residual);
+}
+
+
 double bellmanUpdate(mlcore::Problem* problem, mlcore::State* s)
 {
+    mlcore::ValueStore* values = problem->valueStore();
+    if (values != nullptr && s->index() < values->size())
+        return bellmanUpdate(problem, values, s);
     std::pair<double, mlcore::Action*> best = bellmanBackup(problem, s);
     double residual = s->cost() - best.bb_cost;
-    bellman_mutex.lock();
     s->setCost(best.bb_cost);
     s->setBestAction(best.bb_action);
-    bellman_mutex.unlock();
     return fabs(residual);
 }
 
@@ -80,35 +170,35 @@ double bellmanUpdate(mlcore::Problem* problem, mlcore::State* s, double weight)
         return bellmanUpdate(problem, s);
     double bestQ = problem->goal(s) ? 0.0 : mdplib::dead_end_cost;
     double bestG = bestQ, bestH = bestQ;
-    bool hasAction = false;
     mlcore::Action* bestAction = nullptr;
     double prevCost = s->cost();
-    for (mlcore::Action* a : problem->actions()) {
-        if (!problem->applicable(s, a))
-            continue;
-        hasAction = true;
-        std::pair<double, double> gh = weightedQvalue(problem, s, a);
-        double qAction = std::min(mdplib::dead_end_cost,
-                                   gh.first + weight * gh.second);
+    mlcore::Expansion expansion = problem->expand(s);
+    for (size_t i = 0; i < expansion.size(); i++) {
+        double g = 0.0, h = 0.0;
+        for (const mlcore::Successor& su : expansion.successors(i)) {
+            g += su.su_prob * su.su_state->gValue();
+            h += su.su_prob * su.su_state->hValue();
+        }
+        g = (g * problem->gamma()) + expansion.cost(i);
+        h *= problem->gamma();
+        double qAction = std::min(mdplib::dead_end_cost, g + weight * h);
         if (qAction <= bestQ) {
             bestQ = qAction;
-            bestG = gh.first;
-            bestH = gh.second;
-            bestAction = a;
+            bestG = g;
+            bestH = h;
+            bestAction = expansion.action(i);
         }
     }
 
-    if (!hasAction && bestQ == mdplib::dead_end_cost)
+    if (expansion.empty() && bestQ == mdplib::dead_end_cost)
         s->markDeadEnd();
 
     bestG = std::min(bestG, mdplib::dead_end_cost);
     bestH = std::min(bestH, mdplib::dead_end_cost);
-    bellman_mutex.lock();
     s->setCost(bestQ);
     s->gValue(bestG);
     s->hValue(bestH);
     s->setBestAction(bestAction);
-    bellman_mutex.unlock();
 
     return fabs(bestQ - prevCost);
 }
@@ -119,23 +209,22 @@ mlcore::State* randomSuccessor(mlcore::Problem* problem,
                                mlcore::Action* a,
                                double* prob)
 {
-    double pick = kUnif_0_1(kRNG);
+    return randomSuccessor(problem, s, a, threadRNG(), prob);
+}
+
+
+mlcore::State* randomSuccessor(mlcore::Problem* problem,
+                               mlcore::State* s,
+                               mlcore::Action* a,
+                               mdplib::Rng& rng,
+                               double* prob)
+{
+    double pick = rng.uniform();
 
     if (a == nullptr)
         return s;
 
-    double acc = 0.0;
-    for (mlcore::Successor sccr : problem->transition(s, a)) {
-        acc += sccr.su_prob;
-        if (acc >= pick) {
-            if (prob != nullptr)
-                *prob = sccr.su_prob;
-            return sccr.su_state;
-        }
-    }
-    if (prob != nullptr)
-        *prob = 1.0;
-    return s;
+    return problem->sampleSuccessor(s, a, pick, prob);
 }
 
 
@@ -145,18 +234,16 @@ mlcore::Action* greedyAction(mlcore::Problem* problem, mlcore::State* s)
         return s->bestAction();
     mlcore::Action* bestAction = nullptr;
     double bestQ = mdplib::dead_end_cost;
-    bool hasAction = false;
-    for (mlcore::Action* a : problem->actions()) {
-        if (!problem->applicable(s, a))
-            continue;
-        hasAction = true;
-        double qAction = std::min(mdplib::dead_end_cost, qvalue(problem, s, a));
+    mlcore::Expansion expansion = problem->expand(s);
+    for (size_t i = 0; i < expansion.size(); i++) {
+        double qAction =
+            std::min(mdplib::dead_end_cost, qvalue(problem, expansion, i));
         if (qAction <= bestQ) {
             bestQ = qAction;
-            bestAction = a;
+            bestAction = expansion.action(i);
         }
     }
-    if (!hasAction)
+    if (expansion.empty())
         s->markDeadEnd();
     return bestAction;
 }
@@ -178,7 +265,7 @@ mlcore::State* mostLikelyOutcome(mlcore::Problem* problem, mlcore::State* s,
     double prob = -1.0;
     double eps = 1.0e-6;
     std::vector<mlcore::State*> outcomes;
-    for (mlcore::Successor sccr : problem->transition(s, a)) {
+    for (const mlcore::Successor& sccr : problem->successors(s, a)) {
         if (sccr.su_prob > prob + eps) {
             prob = sccr.su_prob;
             outcomes.clear();
@@ -219,12 +306,14 @@ bool getReachableStates(mlcore::Problem* problem,
                         int horizon)
 {
     bool containsGoal = false;
+    // States are marked when they are added to the set, so that only new
+    // states are inserted.
+    uint32_t epoch = mlcore::State::newVisitEpoch();
     std::list< std::pair<mlcore::State *, int> > stateDepthQueue;
-    if (reachableStates.empty()) {
-        stateDepthQueue.push_front(std::make_pair(problem->initialState(), 0));
+    if (reachableStates.empty())
         reachableStates.insert(problem->initialState());
-    } else {
-        for (auto const & state : reachableStates)
+    for (auto const & state : reachableStates) {
+        if (state->markVisited(epoch))
             stateDepthQueue.push_front(std::make_pair(state, 0));
     }
     bool goalSeen = false;
@@ -246,10 +335,13 @@ bool getReachableStates(mlcore::Problem* problem,
         for (mlcore::Action* a : problem->actions()) {
             if (!problem->applicable(state, a))
                 continue;
-            for (mlcore::Successor sccr : problem->transition(state, a)) {
-                if (reachableStates.insert(sccr.su_state).second)
+            for (const mlcore::Successor& sccr :
+                    problem->successors(state, a)) {
+                if (sccr.su_state->markVisited(epoch)) {
+                    reachableStates.insert(sccr.su_state);
                     stateDepthQueue.
                         push_front(std::make_pair(sccr.su_state, depth + 1));
+                }
             }
         }
     }
@@ -270,6 +362,8 @@ bool getReachableStatesTrajectoryProbs(mlcore::Problem* problem,
     reachableStates.clear();
     tipStates.clear();
     double log_rho = -std::log(rho);
+    uint32_t epoch = mlcore::State::newVisitEpoch();
+    s->markVisited(epoch);
     reachableStates.insert(s);
     while (!trajProbQueue.empty()) {
         auto stateDepthPair = trajProbQueue.back();
@@ -288,9 +382,11 @@ bool getReachableStatesTrajectoryProbs(mlcore::Problem* problem,
         for (mlcore::Action* a : problem->actions()) {
             if (!problem->applicable(state, a))
                 continue;
-            for (mlcore::Successor sccr : problem->transition(state, a)) {
+            for (const mlcore::Successor& sccr :
+                    problem->successors(state, a)) {
                 double newDepth = depth - std::log(sccr.su_prob);
-                if (reachableStates.insert(sccr.su_state).second) {
+                if (sccr.su_state->markVisited(epoch)) {
+                    reachableStates.insert(sccr.su_state);
                     trajProbQueue.
                         push_front(std::make_pair(sccr.su_state, newDepth));
                 }
@@ -315,7 +411,7 @@ void getBestPartialSolutionGraph(mlcore::Problem* problem,
         if (problem->goal(state))
             continue;
         mlcore::Action* a = greedyAction(problem, state);
-        for (mlcore::Successor sccr : problem->transition(state, a)) {
+        for (const mlcore::Successor& sccr : problem->successors(state, a)) {
             stateStack.push_front(sccr.su_state);
         }
     }
@@ -350,7 +446,7 @@ bool testDeadEndRecursion(mlcore::Problem* problem,
         for (mlcore::Action* a : problem->actions()) {
             if (!problem->applicable(state, a))
                 continue;
-            for (auto & successor: problem->transition(state, a)) {
+            for (auto const & successor : problem->successors(state, a)) {
 
                 mlcore::State* next = successor.su_state;
                 successors.push_back(next);
@@ -392,4 +488,183 @@ bool testDeadEnds(mlcore::Problem* problem)
 }
 
 
+
+bool testDeadEnds(const mlcore::CompiledProblem& model)
+{
+    uint32_t s0 = model.initialState();
+    if (s0 == mdplib::no_index)
+        return false;
+    uint32_t n = model.numStates();
+
+    // Forward search from the initial state.
+    std::vector<unsigned char> visited(n, 0);
+    std::vector<uint32_t> stack(1, s0);
+    visited[s0] = 1;
+    bool goalReached = false;
+    while (!stack.empty()) {
+        uint32_t s = stack.back();
+        stack.pop_back();
+        if (model.goal(s)) {
+            goalReached = true;
+            continue;
+        }
+        for (uint32_t sa = model.pairsBegin(s); sa < model.pairsEnd(s); sa++) {
+            for (uint32_t k = model.successorsBegin(sa);
+                    k < model.successorsEnd(sa); k++) {
+                uint32_t next = model.successorState(k);
+                if (!visited[next]) {
+                    visited[next] = 1;
+                    stack.push_back(next);
+                }
+            }
+        }
+    }
+    if (!goalReached)
+        return false;
+
+    // Goals are connected to all states, so all states must be able to reach
+    // a goal. Backward search from the goals over the reverse graph.
+    std::vector<uint32_t> predBegin(n + 1, 0);
+    for (uint32_t s = 0; s < n; s++)
+        for (uint32_t sa = model.pairsBegin(s); sa < model.pairsEnd(s); sa++)
+            for (uint32_t k = model.successorsBegin(sa);
+                    k < model.successorsEnd(sa); k++)
+                predBegin[model.successorState(k) + 1]++;
+    for (uint32_t s = 0; s < n; s++)
+        predBegin[s + 1] += predBegin[s];
+    std::vector<uint32_t> pred(predBegin[n]);
+    std::vector<uint32_t> fill(predBegin.begin(), predBegin.end() - 1);
+    for (uint32_t s = 0; s < n; s++)
+        for (uint32_t sa = model.pairsBegin(s); sa < model.pairsEnd(s); sa++)
+            for (uint32_t k = model.successorsBegin(sa);
+                    k < model.successorsEnd(sa); k++)
+                pred[fill[model.successorState(k)]++] = s;
+
+    std::fill(visited.begin(), visited.end(), 0);
+    for (uint32_t s = 0; s < n; s++) {
+        if (model.goal(s)) {
+            visited[s] = 1;
+            stack.push_back(s);
+        }
+    }
+    uint32_t reached = stack.size();
+    while (!stack.empty()) {
+        uint32_t s = stack.back();
+        stack.pop_back();
+        for (uint32_t i = predBegin[s]; i < predBegin[s + 1]; i++) {
+            if (!visited[pred[i]]) {
+                visited[pred[i]] = 1;
+                reached++;
+                stack.push_back(pred[i]);
+            }
+        }
+    }
+    return reached == n;
+}
+
+
+uint32_t stronglyConnectedComponents(const mlcore::CompiledProblem& model,
+                                     uint32_t root,
+                                     std::vector<uint32_t>& component)
+{
+    uint32_t n = model.numStates();
+    component.assign(n, mdplib::no_index);
+    std::vector<uint32_t> indices(n, mdplib::no_index);
+    std::vector<uint32_t> lowLinks(n, 0);
+    std::vector<unsigned char> onStack(n, 0);
+    std::vector<uint32_t> sccStack;
+    uint32_t index = 0;
+    uint32_t numComponents = 0;
+
+    // Each frame of the explicit call stack holds a state and the position
+    // of the next successor to visit in the state's CSR successor range.
+    struct Frame {
+        uint32_t state;
+        uint32_t next;
+    };
+    std::vector<Frame> callStack;
+
+    // The successors of all actions of a state are contiguous in the CSR
+    // arrays, so a single position walks through all of them. Goals are
+    // given no successors, since their values never change.
+    auto successorsBegin = [&] (uint32_t s) -> uint32_t {
+        if (model.goal(s) || model.pairsBegin(s) == model.pairsEnd(s))
+            return 0;
+        return model.successorsBegin(model.pairsBegin(s));
+    };
+    auto successorsEnd = [&] (uint32_t s) -> uint32_t {
+        if (model.goal(s) || model.pairsBegin(s) == model.pairsEnd(s))
+            return 0;
+        return model.successorsEnd(model.pairsEnd(s) - 1);
+    };
+
+    auto visit = [&] (uint32_t s) {
+        indices[s] = lowLinks[s] = index++;
+        sccStack.push_back(s);
+        onStack[s] = 1;
+        callStack.push_back(Frame{s, successorsBegin(s)});
+    };
+
+    uint32_t first = root == mdplib::no_index ? 0 : root;
+    uint32_t last = root == mdplib::no_index ? n : root + 1;
+    for (uint32_t r = first; r < last; r++) {
+        if (indices[r] != mdplib::no_index)
+            continue;
+        visit(r);
+        while (!callStack.empty()) {
+            Frame& frame = callStack.back();
+            uint32_t s = frame.state;
+            if (frame.next < successorsEnd(s)) {
+                uint32_t next = model.successorState(frame.next++);
+                if (indices[next] == mdplib::no_index)
+                    visit(next);
+                else if (onStack[next])
+                    lowLinks[s] = std::min(lowLinks[s], indices[next]);
+                continue;
+            }
+            if (lowLinks[s] == indices[s]) {
+                uint32_t t;
+                do {
+                    t = sccStack.back();
+                    sccStack.pop_back();
+                    onStack[t] = 0;
+                    component[t] = numComponents;
+                } while (t != s);
+                numComponents++;
+            }
+            callStack.pop_back();
+            if (!callStack.empty()) {
+                uint32_t parent = callStack.back().state;
+                lowLinks[parent] = std::min(lowLinks[parent], lowLinks[s]);
+            }
+        }
+    }
+    return numComponents;
+}
+
+
+double evaluatePolicy(const mlcore::CompiledProblem& model,
+                      const std::vector<uint32_t>& policy,
+                      std::vector<double>& values,
+                      double tol,
+                      int maxIter)
+{
+    double maxResidual = 0.0;
+    for (int i = 0; i < maxIter; i++) {
+        maxResidual = 0.0;
+        for (uint32_t s = 0; s < model.numStates(); s++) {
+            if (model.goal(s) || policy[s] == mdplib::no_index)
+                continue;
+            double value =
+                std::min(mdplib::dead_end_cost, model.qvalue(values, policy[s]));
+            maxResidual = std::max(maxResidual, fabs(value - values[s]));
+            values[s] = value;
+        }
+        if (maxResidual < tol)
+            break;
+    }
+    return maxResidual;
+}
+
+
 } // mlsolvers
@@ -0,0 +1,218 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#include "../../include/solvers/Solver.h"
+#include "../../include/solvers/TopologicalVISolver.h"
+#include "../../include/util/parallel.h"
+
+namespace mlsolvers
+{
+
+TopologicalVISolver::TopologicalVISolver(mlcore::Problem* problem,
+                                         int maxIter,
+                                         double tol)
+{
+    problem_ = problem;
+    compiled_ = nullptr;
+    maxIter_ = maxIter;
+    tol_ = tol;
+    maxTime_ = -1;
+    numThreads_ = 1;
+}
+
+
+TopologicalVISolver::TopologicalVISolver(mlcore::CompiledProblem* compiled,
+                                         int maxIter,
+                                         double tol)
+{
+    problem_ = compiled->problem();
+    compiled_ = compiled;
+    maxIter_ = maxIter;
+    tol_ = tol;
+    maxTime_ = -1;
+    numThreads_ = 1;
+}
+
+
+void TopologicalVISolver::solveCompiled(mlcore::CompiledProblem* model,
+                                        mlcore::State* s0)
+{
+    auto beginTime = std::chrono::high_resolution_clock::now();
+    uint32_t root = s0 == nullptr ? mdplib::no_index : model->number(s0);
+    std::vector<uint32_t> component;
+    uint32_t numComponents =
+        stronglyConnectedComponents(*model, root, component);
+    uint32_t n = model->numStates();
+
+    // Groups the states by component.
+    std::vector<uint32_t> componentBegin(numComponents + 1, 0);
+    for (uint32_t s = 0; s < n; s++)
+        if (component[s] != mdplib::no_index)
+            componentBegin[component[s] + 1]++;
+    for (uint32_t c = 0; c < numComponents; c++)
+        componentBegin[c + 1] += componentBegin[c];
+    std::vector<uint32_t> members(componentBegin[numComponents]);
+    std::vector<uint32_t> fill(componentBegin.begin(), componentBegin.end() - 1);
+    for (uint32_t s = 0; s < n; s++)
+        if (component[s] != mdplib::no_index)
+            members[fill[component[s]]++] = s;
+
+    // The level of a component is the length of the longest path from it to
+    // a sink component in the condensation graph. Components are numbered in
+    // reverse topological order, so the levels of all successor components
+    // are known when a component is reached.
+    std::vector<uint32_t> level(numComponents, 0);
+    uint32_t numLevels = 0;
+    for (uint32_t c = 0; c < numComponents; c++) {
+        for (uint32_t i = componentBegin[c]; i < componentBegin[c + 1]; i++) {
+            uint32_t s = members[i];
+            if (model->goal(s))
+                continue;
+            for (uint32_t sa = model->pairsBegin(s);
+                    sa < model->pairsEnd(s); sa++) {
+                for (uint32_t k = model->successorsBegin(sa);
+                        k < model->successorsEnd(sa); k++) {
+                    uint32_t d = component[model->successorState(k)];
+                    if (d != c)
+                        level[c] = std::max(level[c], level[d] + 1);
+                }
+            }
+        }
+        numLevels = std::max(numLevels, level[c] + 1);
+    }
+    std::vector<uint32_t> levelBegin(numLevels + 1, 0);
+    for (uint32_t c = 0; c < numComponents; c++)
+        levelBegin[level[c] + 1]++;
+    for (uint32_t l = 0; l < numLevels; l++)
+        levelBegin[l + 1] += levelBegin[l];
+    std::vector<uint32_t> byLevel(numComponents);
+    fill.assign(levelBegin.begin(), levelBegin.end() - 1);
+    for (uint32_t c = 0; c < numComponents; c++)
+        byLevel[fill[level[c]]++] = c;
+
+    std::vector<double> values = model->initialValues();
+    std::vector<uint32_t> policy = model->currentPolicy();
+    std::atomic<bool> outOfTime(false);
+
+    auto checkTime = [&] () {
+        auto endTime = std::chrono::high_resolution_clock::now();
+        auto timeElapsed = std::chrono::duration_cast<
+            std::chrono::milliseconds>(endTime - beginTime).count();
+        if (maxTime_ > -1 && timeElapsed > maxTime_)
+            outOfTime = true;
+    };
+
+    // Components at the same level only read the values of their own states
+    // and of components at lower levels, so they can be solved concurrently.
+    // The clock is read after each sweep of a component, and after every
+    // 1024 components.
+    auto solveComponent = [&] (uint32_t c) {
+        uint32_t begin = componentBegin[c], end = componentBegin[c + 1];
+        bool acyclic = false;
+        if (end - begin == 1) {
+            // A single state without a self-loop needs only one backup.
+            uint32_t s = members[begin];
+            acyclic = true;
+            for (uint32_t sa = model->pairsBegin(s);
+                    sa < model->pairsEnd(s) && acyclic; sa++) {
+                for (uint32_t k = model->successorsBegin(sa);
+                        k < model->successorsEnd(sa); k++) {
+                    if (model->successorState(k) == s) {
+                        acyclic = false;
+                        break;
+                    }
+                }
+            }
+        }
+        for (int i = 0; i < maxIter_; i++) {
+            double maxResidual = 0.0;
+            for (uint32_t j = begin; j < end; j++) {
+                uint32_t s = members[j];
+                if (model->goal(s) || model->fixed(s))
+                    continue;
+                double value = model->bellmanBackup(values, s, policy[s]);
+                maxResidual = std::max(maxResidual, fabs(value - values[s]));
+                values[s] = value;
+            }
+            if (acyclic || maxResidual < tol_)
+                break;
+            checkTime();
+            if (outOfTime)
+                break;
+        }
+    };
+
+    int numThreads = numThreads_;
+    uint32_t currentLevel = 0;
+    std::atomic<uint32_t> nextComponent(0);
+    bool finished = false;
+    Barrier barrier(numThreads);
+
+    auto solveLevel = [&] () {
+        while (!outOfTime) {
+            uint32_t i = levelBegin[currentLevel] + nextComponent++;
+            if (i >= levelBegin[currentLevel + 1])
+                break;
+            solveComponent(byLevel[i]);
+            if (i % 1024 == 0)
+                checkTime();
+        }
+    };
+
+    // Thread 0 walks through the levels; levels with a single component are
+    // solved by thread 0 alone, while the other threads wait at the barrier
+    // until a level with several components is reached.
+    runThreads(numThreads, [&] (int t) {
+        if (t != 0) {
+            while (true) {
+                barrier.wait();
+                if (finished)
+                    break;
+                solveLevel();
+                barrier.wait();
+            }
+            return;
+        }
+        for (uint32_t l = 0; l < numLevels && !outOfTime; l++) {
+            uint32_t size = levelBegin[l + 1] - levelBegin[l];
+            if (numThreads == 1 || size == 1) {
+                for (uint32_t i = levelBegin[l]; i < levelBegin[l + 1]; i++) {
+                    solveComponent(byLevel[i]);
+                    if (i % 1024 == 0)
+                        checkTime();
+                    if (outOfTime)
+                        break;
+                }
+                continue;
+            }
+            // The other threads are blocked at the barrier, so the level
+            // can be set before releasing them.
+            currentLevel = l;
+            nextComponent = 0;
+            barrier.wait();
+            solveLevel();
+            barrier.wait();
+        }
+        finished = true;
+        barrier.wait();
+    });
+
+    model->commit(values, policy);
+}
+
+
+mlcore::Action* TopologicalVISolver::solve(mlcore::State* s0)
+{
+    if (compiled_ != nullptr) {
+        solveCompiled(compiled_, s0);
+    } else {
+        problem_->syncValueStore();
+        mlcore::CompiledProblem model(problem_);
+        solveCompiled(&model, s0);
+        problem_->reloadValueStore();
+    }
+    return nullptr;
+}
+
+}
@@ -4,99 +4,317 @@
 #include "../../include/solvers/Solver.h"
 #include "../../include/solvers/UCTSolver.h"
 
+#include "../../include/util/parallel.h"
+
 namespace mlsolvers
 {
 
-mlcore::Action* UCTSolver::pickAction(UCTNode* node, double C)
+UCTNode* UCTSolver::getNode(Worker& worker, mlcore::State* s, int depth)
 {
-    double best = mdplib::dead_end_cost + 1;
-    mlcore::Action* bestAction = nullptr;
-    std::vector<mlcore::Action*> unexplored_actions;
-    auto actions_qvalue_map = action_qvalues_[node];
-    int num_actions = actions_qvalue_map.size();
-    for (auto action_and_qvalue : actions_qvalue_map) {
-        mlcore::Action* a = action_and_qvalue.first;
-        if (!problem_->applicable(node->state_, a))
+    UCTTree& tree = *worker.tree_;
+    bool shared = sharedTree();
+    UCTNodeKey key(s, depth);
+    {
+        std::unique_lock<std::mutex> lock(tree.mutex_, std::defer_lock);
+        if (shared)
+            lock.lock();
+        auto it = tree.index_.find(key);
+        if (it != tree.index_.end())
+            return it->second;
+    }
+    // This is a new node. Must initialize counters and Q-values. The
+    // Q-values are computed without holding the lock, so another thread
+    // may add the node first.
+    std::vector<double>& qvalues = worker.qvalues_;
+    qvalues.clear();
+    for (mlcore::Action* a : problem_->actions()) {
+        if (!problem_->applicable(s, a))
+            continue;
+        qvalues.push_back(qvalue(problem_, s, a));
+                                                                                dprint("new-q", s, a, qvalues.back());
+    }
+    std::unique_lock<std::mutex> lock(tree.mutex_, std::defer_lock);
+    if (shared)
+        lock.lock();
+    auto it = tree.index_.insert(std::make_pair(key, nullptr));
+    if (!it.second)
+        return it.first->second;
+    UCTNode* node = tree.nodes_.allocate(1);
+    node->state_ = s;
+    node->depth_ = depth;
+    node->numActions_ = qvalues.size();
+    node->actions_ = tree.actions_.allocate(node->numActions_);
+    int i = 0;
+    for (mlcore::Action* a : problem_->actions()) {
+        if (!problem_->applicable(s, a))
             continue;
-        if (counters_node_action_[node][a] == delta_) {  // unexplored action
-            unexplored_actions.push_back(a);
+        UCTActionStats& stats = node->actions_[i];
+        stats.action_ = a;
+        stats.count_.store(delta_, std::memory_order_relaxed);
+        stats.qvalue_.store(qvalues[i], std::memory_order_relaxed);
+        stats.pending_.store(0, std::memory_order_relaxed);
+        i++;
+    }
+    // not sure about this
+    node->count_.store(delta_ * i, std::memory_order_relaxed);
+    it.first->second = node;
+    return node;
+}
+
+UCTActionStats* UCTSolver::pickAction(Worker& worker, UCTNode* node, double C)
+{
+    double best = mdplib::dead_end_cost + 1;
+    UCTActionStats* bestAction = nullptr;
+    std::vector<UCTActionStats*>& unexplored_actions = worker.unexplored_;
+    unexplored_actions.clear();
+    int num_actions = node->numActions_;
+    for (int i = 0; i < num_actions; i++) {
+        UCTActionStats& stats = node->actions_[i];
+        if (stats.count_.load(std::memory_order_relaxed) == delta_ &&
+                stats.pending_.load(std::memory_order_relaxed) == 0) {
+            unexplored_actions.push_back(&stats);  // unexplored action
             continue;
         }
         if (use_qvalues_for_c_) {
-            C = action_and_qvalue.second;
+            C = stats.qvalue_.load(std::memory_order_relaxed);
             C /= sqrt(log(num_actions) / (delta_ + 1) + 1);
         }
-        double ucb1 = ucb1Cost(node, a, C);
+        double ucb1 = ucb1Cost(*node, stats, C);
         if (ucb1 < best) {
-            bestAction = a;
+            bestAction = &stats;
             best = ucb1;
         }
     }
     if (unexplored_actions.size() > 0) {
-        int idx = rand() % unexplored_actions.size();
+        size_t idx = worker.rng_.below(unexplored_actions.size());
         return unexplored_actions[idx];
     }
     return bestAction;
 }
 
-double UCTSolver::ucb1Cost(UCTNode* node, mlcore::Action* a, double C)
+double UCTSolver::ucb1Cost(const UCTNode& node,
+                           const UCTActionStats& stats,
+                           double C) const
 {
-    double cost = action_qvalues_[node][a] - C
-        * std::sqrt(std::log(counters_node_[node])
-                    / counters_node_action_[node][a]);
+    int pending = stats.pending_.load(std::memory_order_relaxed);
+    double cost = stats.qvalue_.load(std::memory_order_relaxed)
+        + pending * virtual_loss_ - C
+        * std::sqrt(std::log(std::max(1, node.count_.load(
+                                             std::memory_order_relaxed)))
+                    / (stats.count_.load(std::memory_order_relaxed)
+                        + pending));
     return std::min(cost, mdplib::dead_end_cost);
 }
 
-mlcore::Action* UCTSolver::solve(mlcore::State* s0)
+void UCTSolver::rollouts(Worker& worker, mlcore::State* s0, int max_rollouts)
 {
-    UCTNode* root = new UCTNode(s0, start_depth_);
-    for (int r = 0; r < max_rollouts_; r++) {
-        UCTNode* tmp_node = root;
-        std::vector<int> cumCost(cutoff_ + 1);
-        std::vector<UCTNode*> nodes_in_rollout(cutoff_ + 1);
-        std::vector<mlcore::Action*> actions_in_rollout(cutoff_ + 1);
+    bool shared = sharedTree();
+    worker.nodes_.resize(cutoff_ + 1);
+    worker.actions_.resize(cutoff_ + 1);
+    worker.costs_.assign(cutoff_ + 1, 0.0);
+    for (int r = 0; r < max_rollouts; r++) {
+        worker.rng_.seed(rngSeed(), worker.first_stream_ + r);
+        mlcore::State* tmp = s0;
+        int depth = start_depth_;
         int maxSteps = 0;
         for (int i = 1; i <= cutoff_; i++) {
-            bool first_time_seen = visited_.insert(tmp_node).second;
-            // This is a new node. Must initialize counters and Q-values
-            if (first_time_seen) {
-                counters_node_[tmp_node] = 0;
-                for (mlcore::Action* a : problem_->actions()) {
-                    if (!problem_->applicable(tmp_node->state_, a))
-                        continue;
-                    counters_node_action_[tmp_node][a] = delta_;
-                    counters_node_[tmp_node] += delta_; // not sure about this
-                    action_qvalues_[tmp_node][a] =
-                        qvalue(problem_, tmp_node->state_, a);
-                                                                                dprint("new-q", tmp_node->state_, a, action_qvalues_[tmp_node][a]);
-                }
-            }
-            if (problem_->goal(tmp_node->state_))
+            UCTNode* node = getNode(worker, tmp, depth);
+            if (problem_->goal(tmp))
                 break;
             maxSteps = i;
-            mlcore::Action* a = pickAction(tmp_node, C_);
-            mlcore::State* next =
-                randomSuccessor(problem_, tmp_node->state_, a);
-            cumCost[i] = cumCost[i - 1] + problem_->cost(tmp_node->state_, a);
-            nodes_in_rollout[i] = tmp_node;
-            actions_in_rollout[i] = a;
-            tmp_node = new UCTNode(next, tmp_node->depth_ + 1);
+            UCTActionStats* stats = pickAction(worker, node, C_);
+            mlcore::Action* a = nullptr;
+            if (stats != nullptr) {
+                a = stats->action_;
+                if (shared)
+                    stats->pending_.fetch_add(1, std::memory_order_relaxed);
+            }
+            worker.costs_[i] = worker.costs_[i - 1] + problem_->cost(tmp, a);
+            worker.nodes_[i] = node;
+            worker.actions_[i] = stats;
+            tmp = randomSuccessor(problem_, tmp, a, worker.rng_);
+            depth++;
         }
 
         for (int i = 1; i <= maxSteps; i++) {
-            UCTNode* node = nodes_in_rollout[i];
-            mlcore::Action* a = actions_in_rollout[i];
-            counters_node_[node]++;
-            counters_node_action_[node][a]++;
-            double cumCostNode = cumCost[maxSteps] - cumCost[i - 1];
-//            double newq = (counters_node_action_[node][a]
-//                * action_qvalues_[node][a]) + cumCostNode;
-//            newq /= (counters_node_action_[node][a] + 1);
-//            action_qvalues_[node][a] = newq;
-            double delta_target =
-                (cumCostNode - action_qvalues_[node][a])
-                    / (counters_node_action_[node][a]);
-            action_qvalues_[node][a] += delta_target    ;
+            UCTNode* node = worker.nodes_[i];
+            UCTActionStats* stats = worker.actions_[i];
+            double cumCostNode =
+                worker.costs_[maxSteps] - worker.costs_[i - 1];
+//            double newq = (stats->count_ * stats->qvalue_) + cumCostNode;
+//            newq /= (stats->count_ + 1);
+//            stats->qvalue_ = newq;
+            if (!shared) {
+                node->count_.store(node->count_.load(std::memory_order_relaxed)
+                                   + 1, std::memory_order_relaxed);
+                if (stats == nullptr)
+                    continue;
+                int count = stats->count_.load(std::memory_order_relaxed) + 1;
+                double q = stats->qvalue_.load(std::memory_order_relaxed);
+                double delta_target = (cumCostNode - q) / count;
+                stats->count_.store(count, std::memory_order_relaxed);
+                stats->qvalue_.store(q + delta_target,
+                                     std::memory_order_relaxed);
+                continue;
+            }
+            node->count_.fetch_add(1, std::memory_order_relaxed);
+            if (stats == nullptr)
+                continue;
+            int count =
+                stats->count_.fetch_add(1, std::memory_order_relaxed) + 1;
+            double q = stats->qvalue_.load(std::memory_order_relaxed);
+            while (!stats->qvalue_.compare_exchange_weak(
+                        q, q + (cumCostNode - q) / count,
+                        std::memory_order_relaxed)) { }
+            stats->pending_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void UCTSolver::mergeRoots(mlcore::State* s0)
+{
+    UCTNodeKey key(s0, start_depth_);
+    auto root = tree_.index_.find(key);
+    if (root == tree_.index_.end())
+        return;
+    UCTNode* merged = root->second;
+    for (std::unique_ptr<UCTTree>& tree : worker_trees_) {
+        auto it = tree->index_.find(key);
+        if (it == tree->index_.end())
+            continue;
+        UCTNode* node = it->second;
+        // Both roots list the applicable actions of s0 in the same order.
+        merged->count_ += node->count_ - delta_ * (int) node->numActions_;
+        for (uint32_t i = 0; i < node->numActions_; i++) {
+            UCTActionStats& to = merged->actions_[i];
+            UCTActionStats& from = node->actions_[i];
+            int count = to.count_ + from.count_;
+            if (count > 0) {
+                to.qvalue_ = (to.qvalue_ * to.count_ +
+                              from.qvalue_ * from.count_) / count;
+            }
+            to.count_ += from.count_ - delta_;
+        }
+    }
+}
+
+void UCTSolver::pruneTree(UCTTree& tree, mlcore::State* s0)
+{
+    UCTNodeKey rootKey(s0, start_depth_);
+    auto root = tree.index_.find(rootKey);
+    if (root == tree.index_.end()) {
+        tree.clear(true);
+        return;
+    }
+    if (tree.index_.size() < 2 * tree.keptSize_)
+        return;
+
+    UCTTree kept;
+    // Copies a node into kept (with its action statistics) and returns it.
+    auto copyNode = [&kept] (const UCTNodeKey& key, UCTNode* node) {
+        UCTNode* copy = kept.nodes_.allocate(1);
+        copy->state_ = node->state_;
+        copy->depth_ = node->depth_;
+        copy->count_.store(node->count_.load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+        copy->numActions_ = node->numActions_;
+        copy->actions_ = kept.actions_.allocate(node->numActions_);
+        for (uint32_t i = 0; i < node->numActions_; i++) {
+            UCTActionStats& to = copy->actions_[i];
+            UCTActionStats& from = node->actions_[i];
+            to.action_ = from.action_;
+            to.count_.store(from.count_.load(std::memory_order_relaxed),
+                            std::memory_order_relaxed);
+            to.qvalue_.store(from.qvalue_.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+            to.pending_.store(0, std::memory_order_relaxed);
+        }
+        kept.index_[key] = copy;
+        return copy;
+    };
+    std::vector<UCTNode*> stack(1, copyNode(rootKey, root->second));
+    // Copies the node for the given state and depth, if it was visited.
+    auto visit = [&] (mlcore::State* s, int depth) {
+        UCTNodeKey key(s, depth);
+        if (kept.index_.count(key) > 0)
+            return;
+        auto child = tree.index_.find(key);
+        if (child != tree.index_.end())
+            stack.push_back(copyNode(key, child->second));
+    };
+
+    while (!stack.empty()) {
+        UCTNode* node = stack.back();
+        stack.pop_back();
+        // Rollouts stay in the same state when there is no applicable
+        // action (see randomSuccessor).
+        visit(node->state_, node->depth_ + 1);
+        for (uint32_t i = 0; i < node->numActions_; i++) {
+            UCTActionStats& stats = node->actions_[i];
+            // Only actions chosen by some rollout can lead to children.
+            if (stats.count_.load(std::memory_order_relaxed) <= delta_)
+                continue;
+            for (const mlcore::Successor& su :
+                    problem_->successors(node->state_, stats.action_))
+                visit(su.su_state, node->depth_ + 1);
+        }
+    }
+    kept.keptSize_ = kept.index_.size();
+    tree.swap(kept);
+}
+
+mlcore::Action* UCTSolver::solve(mlcore::State* s0)
+{
+    if (auto_adjust_depth_) {
+        pruneTree(tree_, s0);
+        for (std::unique_ptr<UCTTree>& tree : worker_trees_)
+            pruneTree(*tree, s0);
+    }
+    // Each rollout gets its own random number stream, so that rollout r
+    // draws the same numbers for any number of threads.
+    uint64_t first_stream = reserveRNGStreams(std::max(max_rollouts_, 0));
+    if (num_threads_ == 1) {
+        Worker worker;
+        worker.tree_ = &tree_;
+        worker.first_stream_ = first_stream;
+        rollouts(worker, s0, max_rollouts_);
+    } else {
+        bool rootParallel = parallel_mode_ == uct_root_parallel;
+        if (rootParallel) {
+            while ((int) worker_trees_.size() < num_threads_ - 1)
+                worker_trees_.push_back(
+                    std::unique_ptr<UCTTree>(new UCTTree()));
+        }
+        std::vector<Worker> workers(num_threads_);
+        int per_thread = max_rollouts_ / num_threads_;
+        int remainder = max_rollouts_ % num_threads_;
+        for (int t = 0; t < num_threads_; t++) {
+            workers[t].tree_ = (t == 0 || !rootParallel) ?
+                &tree_ : worker_trees_[t - 1].get();
+            workers[t].first_stream_ =
+                first_stream + t * per_thread + std::min(t, remainder);
+        }
+        bool concurrentStates = problem_->concurrentStates();
+        problem_->concurrentStates(true);
+        runThreads(num_threads_, [&] (int t) {
+            int n = per_thread + (t < remainder ? 1 : 0);
+            rollouts(workers[t], s0, n);
+        });
+        problem_->concurrentStates(concurrentStates);
+        if (rootParallel)
+            mergeRoots(s0);
+    }
+
+    mlcore::Action* bestAction = nullptr;
+    const UCTNode* root = root_policy_ ? node(s0, start_depth_) : nullptr;
+    if (root != nullptr) {
+        double bestQ = mdplib::dead_end_cost + 1;
+        for (uint32_t i = 0; i < root->numActions_; i++) {
+            const UCTActionStats& stats = root->actions_[i];
+            if (stats.count_ > delta_ && stats.qvalue_ < bestQ) {
+                bestQ = stats.qvalue_;
+                bestAction = stats.action_;
+            }
         }
     }
 
@@ -104,10 +322,13 @@ mlcore::Action* UCTSolver::solve(mlcore::State* s0)
         cutoff_++;
         start_depth_++;
     } else {
-        visited_.clear();
+        tree_.clear(false);
+        for (std::unique_ptr<UCTTree>& tree : worker_trees_)
+            tree->clear(false);
     }
-    return greedyAction(problem_, s0);
+    if (bestAction == nullptr)
+        return greedyAction(problem_, s0);
+    return bestAction;
 }
 
 }
-
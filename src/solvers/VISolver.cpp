@@ -1,3 +1,4 @@
+#include <atomic>
 #include <list>
 #include <climits>
 #include <cmath>
@@ -6,19 +7,152 @@
 #include "../../include/solvers/VISolver.h"
 #include "../../include/State.h"
 #include "../../include/util/general.h"
+#include "../../include/util/parallel.h"
 
 namespace mlsolvers
 {
+    namespace
+    {
+    /* Stores the value of state s (see CompiledProblem::value()). */
+    inline void store(std::vector<double>& values, uint32_t s, double value)
+    {
+        values[s] = value;
+    }
+
+    inline void store(std::vector< std::atomic<double> >& values,
+                      uint32_t s, double value)
+    {
+        values[s].store(value, std::memory_order_relaxed);
+    }
+    }
+
     VISolver::VISolver(mlcore::Problem* problem, int maxIter, double tol)
     {
         problem_ = problem;
+        compiled_ = nullptr;
+        maxIter_ = maxIter;
+        tol_ = tol;
+        maxTime_ = -1;
+        numThreads_ = 1;
+        updateMode_ = vi_gauss_seidel;
+    }
+
+    VISolver::VISolver(mlcore::CompiledProblem* compiled,
+                       int maxIter,
+                       double tol)
+    {
+        problem_ = compiled->problem();
+        compiled_ = compiled;
         maxIter_ = maxIter;
         tol_ = tol;
         maxTime_ = -1;
+        numThreads_ = 1;
+        updateMode_ = vi_gauss_seidel;
+    }
+
+    template<typename Values>
+    Values* VISolver::sweep(mlcore::CompiledProblem* model,
+                            Values* current,
+                            Values* target,
+                            std::vector<uint32_t>& policy,
+                            int numThreads)
+    {
+        auto beginTime = std::chrono::high_resolution_clock::now();
+        uint32_t n = model->numStates();
+        std::vector<double> residuals(numThreads, 0.0);
+        std::atomic<uint32_t> nextChunk(0);
+        std::atomic<bool> outOfTime(false);
+        bool finished = false;
+        int iteration = 0;
+        Barrier barrier(numThreads);
+
+        auto run = [&] (int t) {
+            while (!finished) {
+                double maxResidual = 0.0;
+                while (!outOfTime.load(std::memory_order_relaxed)) {
+                    uint32_t begin = nextChunk.fetch_add(chunkSize);
+                    if (begin >= n)
+                        break;
+                    uint32_t end = std::min(n, begin + chunkSize);
+                    for (uint32_t s = begin; s < end; s++) {
+                        if (model->goal(s) || model->fixed(s))
+                            continue;
+                        double value =
+                            model->bellmanBackup(*current, s, policy[s]);
+                        double previous =
+                            mlcore::CompiledProblem::value(*current, s);
+                        maxResidual = std::max(maxResidual,
+                                               fabs(value - previous));
+                        store(*target, s, value);
+                    }
+                    auto endTime = std::chrono::high_resolution_clock::now();
+                    auto timeElapsed = std::chrono::duration_cast<
+                        std::chrono::milliseconds>(endTime - beginTime).count();
+                    if (maxTime_ > -1 && timeElapsed > maxTime_)
+                        outOfTime = true;
+                }
+                residuals[t] = maxResidual;
+                barrier.wait([&] {
+                    double sweepResidual = *std::max_element(residuals.begin(),
+                                                             residuals.end());
+                    if (current != target && !outOfTime)
+                        std::swap(current, target);
+                    nextChunk = 0;
+                    iteration++;
+                    finished = sweepResidual < tol_ || outOfTime ||
+                        iteration >= maxIter_;
+                });
+            }
+        };
+        if (maxIter_ > 0)
+            runThreads(numThreads, run);
+        return current;
+    }
+
+    void VISolver::solveCompiled(mlcore::CompiledProblem* model)
+    {
+        // No sweep would run, so there is nothing to write back.
+        if (maxIter_ <= 0)
+            return;
+        uint32_t n = model->numStates();
+        std::vector<double> values = model->initialValues();
+        // States that are not backed up (e.g., if the time runs out) keep
+        // their current best action when the policy is committed.
+        std::vector<uint32_t> policy = model->currentPolicy();
+        int numThreads = std::max(1, std::min<int>(numThreads_,
+                                                   n / chunkSize + 1));
+        if (updateMode_ == vi_jacobi) {
+            std::vector<double> next = values;
+            model->commit(*sweep(model, &values, &next, policy, numThreads),
+                          policy);
+        } else if (numThreads > 1) {
+            // The threads read values that other threads are updating.
+            std::vector< std::atomic<double> > shared(n);
+            for (uint32_t s = 0; s < n; s++)
+                store(shared, s, values[s]);
+            sweep(model, &shared, &shared, policy, numThreads);
+            for (uint32_t s = 0; s < n; s++)
+                values[s] = mlcore::CompiledProblem::value(shared, s);
+            model->commit(values, policy);
+        } else {
+            sweep(model, &values, &values, policy, numThreads);
+            model->commit(values, policy);
+        }
     }
 
     mlcore::Action* VISolver::solve(mlcore::State* s0)
     {
+        if (compiled_ != nullptr) {
+            solveCompiled(compiled_);
+            return nullptr;
+        }
+        if (numThreads_ > 1 || updateMode_ == vi_jacobi) {
+            problem_->syncValueStore();
+            mlcore::CompiledProblem model(problem_);
+            solveCompiled(&model);
+            problem_->reloadValueStore();
+            return nullptr;
+        }
         auto beginTime = std::chrono::high_resolution_clock::now();
         for (int i = 0; i < maxIter_; i++) {
             double maxResidual = 0.0;
@@ -32,12 +166,15 @@ namespace mlsolvers
                 auto endTime = std::chrono::high_resolution_clock::now();
                 auto timeElapsed = std::chrono::duration_cast<
                     std::chrono::milliseconds>(endTime - beginTime).count();
-                if (maxTime_ > -1 && timeElapsed > maxTime_)
+                if (maxTime_ > -1 && timeElapsed > maxTime_) {
+                    problem_->syncValueStore();
                     return nullptr;
+                }
             }
             if (maxResidual < tol_)
-                return nullptr;
+                break;
         }
+        problem_->syncValueStore();
         return nullptr;
     }
 }
@@ -31,18 +31,14 @@ int main(int argc, char* args[])
         nrolls = atoi(args[1]);
     UCTSolver uct(problem, 0, nrolls, 100);
     Action* a = uct.solve(problem->initialState());
-    StateActionDoubleMap& qvalues = uct.qvalues();
-    StateActionIntMap& counterSA = uct.counterSA();
-
-    for (pair <State*, ActionDoubleMap> entry : qvalues) {
-        for (pair <Action*, double> entry2 : entry.second) {
-            State* s = entry.first;
-            Action* a = entry2.first;
-            dprint2(s,a);
-            dprint2("QVALUE ", qvalues[s][a]);
-            dprint2("COUNTER ", counterSA[s][a]);
-            dprint2("UCB1COST ", uct.ucb1Cost(s,a,qvalues[s][a]));
-        }
+    State* s = problem->initialState();
+    const UCTNode* root = uct.node(s, 0);
+    for (uint32_t i = 0; root != nullptr && i < root->numActions_; i++) {
+        const UCTActionStats& stats = uct.actionStats(root)[i];
+        dprint(s, stats.action_);
+        dprint("QVALUE ", stats.qvalue_.load());
+        dprint("COUNTER ", stats.count_.load());
+        dprint("UCB1COST ", uct.ucb1Cost(*root, stats, stats.qvalue_.load()));
     }
 
     delete ((BinaryTreeProblem *) problem);
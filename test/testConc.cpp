@@ -149,7 +149,8 @@ int main(int argc, char *args[])
     double costPlan = (double) initialPlanningT / kappa;
     double costExec = 0.0;
     while (true) {
-        solverMutex.lock();
+        // Pauses the planner while the execution thread uses the problem.
+        unique_lock<mutex> lock(solverMutex);
 
         if (problem->goal(cur)) {
             if (verbosity > 0)
@@ -157,7 +158,7 @@ int main(int argc, char *args[])
                      << initialPlanningT << " " << actionT << endl;
 
             solver->setKeepRunning(false);
-            solverMutex.unlock();
+            lock.unlock();
 
             delete solver;
             delete problem;
@@ -185,7 +186,6 @@ int main(int argc, char *args[])
         }
 
         if (a == nullptr) {
-            solverMutex.unlock();
             if (verbosity > 100)
                 cerr << "No Action! " << cur << endl;
 
@@ -213,7 +213,7 @@ int main(int argc, char *args[])
             cerr << "; acc. cost plan. " << costPlan << endl;
         }
 
-        solverMutex.unlock();
+        lock.unlock();
 
         if (strcmp(args[1], "det") != 0)
             this_thread::sleep_for(
@@ -62,7 +62,7 @@ int main(int argc, char* args[])
     }
     clock_t endTime = clock();
 
-    StateSet states = problem->states();
+    StateSet states(problem->states().begin(), problem->states().end());
     cout << problem->states().size() << endl;
     cout << problem->initialState()->cost() << endl;
     cout << "solved in " << double(endTime - startTime) / CLOCKS_PER_SEC << endl;
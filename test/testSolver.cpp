@@ -15,10 +15,12 @@
 #include "../include/solvers/HOPSolver.h"
 #include "../include/solvers/LAOStarSolver.h"
 #include "../include/solvers/LRTDPSolver.h"
+#include "../include/solvers/PrioritizedSweepingSolver.h"
 #include "../include/solvers/FLARESSolver.h"
 #include "../include/solvers/SoftFLARESSolver.h"
 #include "../include/solvers/Solver.h"
 #include "../include/solvers/SSiPPSolver.h"
+#include "../include/solvers/TopologicalVISolver.h"
 #include "../include/solvers/UCTSolver.h"
 #include "../include/solvers/VISolver.h"
 #include "../include/solvers/VPIRTDPSolver.h"
@@ -34,11 +36,13 @@
 #include "../include/domains/ctp/CTPState.h"
 
 #include "../include/domains/gridworld/GridWorldProblem.h"
+#include "../include/domains/gridworld/GWDijkstraHeuristic.h"
 #include "../include/domains/gridworld/GWManhattanHeuristic.h"
 
 #include "../include/domains/racetrack/RacetrackProblem.h"
 #include "../include/domains/racetrack/RTrackDetHeuristic.h"
 
+#include "../include/domains/sailing/SailingDijkstraHeuristic.h"
 #include "../include/domains/sailing/SailingNoWindHeuristic.h"
 #include "../include/domains/sailing/SailingProblem.h"
 
@@ -50,6 +54,7 @@ using namespace std;
 
 
 Problem* problem = nullptr;
+CompiledProblem* compiledProblem = nullptr;
 Heuristic* heuristic = nullptr;
 bool useUpperBound = false;
 
@@ -78,8 +83,13 @@ void setupRacetrack()
     ((RacetrackProblem*) problem)->pSlip(pslip);
     ((RacetrackProblem*) problem)->mds(mds);
     if (!flag_is_registered_with_value("heuristic") ||
-            flag_value("heuristic") == "domain")
-        heuristic = new RTrackDetHeuristic(trackName.c_str());
+            flag_value("heuristic") == "domain") {
+        // The cached costs are stored next to the track.
+        string cacheName = trackName + ".detcost";
+        heuristic = new RTrackDetHeuristic(
+            trackName.c_str(),
+            flag_is_registered("heuristic-cache") ? cacheName.c_str() : nullptr);
+    }
 }
 
 void setupBorderExitProblem()
@@ -88,16 +98,61 @@ void setupBorderExitProblem()
 }
 
 
+// Creates a random grid world generator of size WxH (--grid-gen=WxH).
+GridWorldGenerator makeGridGenerator()
+{
+    string size = flag_value("grid-gen");
+    size_t sep = size.find('x');
+    if (sep == string::npos) {
+        cerr << "Invalid grid size " << size << endl;
+        exit(-1);
+    }
+    int width = stoi(size.substr(0, sep));
+    int height = stoi(size.substr(sep + 1));
+    uint64_t seed = 0;
+    if (flag_is_registered_with_value("gw-seed"))
+        seed = stoull(flag_value("gw-seed"));
+    GridWorldGenerator generator(width, height, seed);
+    if (flag_is_registered_with_value("gw-walls"))
+        generator.walls(stod(flag_value("gw-walls")));
+    if (flag_is_registered_with_value("gw-holes"))
+        generator.holes(stod(flag_value("gw-holes")));
+    if (flag_is_registered_with_value("gw-dead-ends"))
+        generator.deadEnds(stod(flag_value("gw-dead-ends")));
+    if (flag_is_registered_with_value("gw-goals"))
+        generator.addRandomGoals(stoi(flag_value("gw-goals")));
+    if (flag_is_registered("gw-no-corridors"))
+        generator.corridors(false);
+    return generator;
+}
+
+
 void setupGridWorld()
 {
-    string grid = flag_value("grid");
-    if (verbosity > 100)
-        cout << "Setting up grid world " << grid << endl;
     bool all_directions = flag_is_registered("gw-all-dir");
-    problem = new GridWorldProblem(grid.c_str(), 1.0, 50.0, all_directions);
+    if (flag_is_registered_with_value("grid-gen")) {
+        GridWorldGenerator generator = makeGridGenerator();
+        if (flag_is_registered_with_value("gw-write")) {
+            // Only writes the map.
+            ofstream out(flag_value("gw-write"));
+            generator.write(out);
+            out.close();
+            exit(0);
+        }
+        if (verbosity > 100)
+            cout << "Generating grid world " << flag_value("grid-gen") << endl;
+        problem = new GridWorldProblem(generator, 1.0, 50.0, all_directions);
+    } else {
+        string grid = flag_value("grid");
+        if (verbosity > 100)
+            cout << "Setting up grid world " << grid << endl;
+        problem = new GridWorldProblem(grid.c_str(), 1.0, 50.0, all_directions);
+    }
     if (!flag_is_registered_with_value("heuristic") ||
             flag_value("heuristic") == "domain")
         heuristic = new GWManhattanHeuristic((GridWorldProblem*) problem);
+    else if (flag_value("heuristic") == "dijkstra")
+        heuristic = new GWDijkstraHeuristic((GridWorldProblem*) problem);
 }
 
 
@@ -144,6 +199,9 @@ void setupSailingDomain()
             flag_value("heuristic") == "domain")
         heuristic =
             new SailingNoWindHeuristic(static_cast<SailingProblem*>(problem));
+    else if (flag_value("heuristic") == "dijkstra")
+        heuristic =
+            new SailingDijkstraHeuristic(static_cast<SailingProblem*>(problem));
 }
 
 
@@ -167,7 +225,8 @@ void setupProblem()
         cout << "Setting up problem" << endl;
     if (flag_is_registered_with_value("track")) {
         setupRacetrack();
-    } else if (flag_is_registered_with_value("grid")) {
+    } else if (flag_is_registered_with_value("grid") ||
+               flag_is_registered_with_value("grid-gen")) {
         setupGridWorld();
     } else if (flag_is_registered_with_value("sailing-size")) {
         setupSailingDomain();
@@ -215,6 +274,10 @@ void initSolver(string algorithm, Solver*& solver)
         solver = new LAOStarSolver(problem, tol, 1000000);
     } else if (algorithm == "lrtdp") {
         solver = new LRTDPSolver(problem, trials, tol, -1);
+        if (flag_is_registered_with_value("threads")) {
+            static_cast<LRTDPSolver*>(solver)->numThreads(
+                stoi(flag_value("threads")));
+        }
     } else if (algorithm == "brtdp") {
         double ub = 0.0;
         if (flag_is_registered_with_value("ub"))
@@ -326,7 +389,32 @@ void initSolver(string algorithm, Solver*& solver)
         else
             solver = new HDPSolver(problem, tol);
     } else if (algorithm == "vi") {
-        solver = new VISolver(problem, 1000000000, tol);
+        if (flag_is_registered("compiled")) {
+            if (compiledProblem == nullptr)
+                compiledProblem = new CompiledProblem(problem);
+            solver = new VISolver(compiledProblem, 1000000000, tol);
+        } else {
+            solver = new VISolver(problem, 1000000000, tol);
+        }
+        VISolver* vi = static_cast<VISolver*>(solver);
+        if (flag_is_registered_with_value("threads"))
+            vi->numThreads(stoi(flag_value("threads")));
+        if (flag_is_registered("jacobi"))
+            vi->updateMode(vi_jacobi);
+    } else if (algorithm == "tvi") {
+        if (flag_is_registered("compiled")) {
+            if (compiledProblem == nullptr)
+                compiledProblem = new CompiledProblem(problem);
+            solver = new TopologicalVISolver(compiledProblem, 1000000000, tol);
+        } else {
+            solver = new TopologicalVISolver(problem, 1000000000, tol);
+        }
+        if (flag_is_registered_with_value("threads")) {
+            static_cast<TopologicalVISolver*>(solver)->numThreads(
+                stoi(flag_value("threads")));
+        }
+    } else if (algorithm == "ps") {
+        solver = new PrioritizedSweepingSolver(problem, 1000000000, tol);
     } else if (algorithm == "ssipp") {
         double rho = -1.0;
         bool useTrajProb = false;
@@ -377,10 +465,31 @@ void initSolver(string algorithm, Solver*& solver)
             C = stod(flag_value("cexp"));
             use_qvalues_for_c = false;
         }
+        int parallel_mode = uct_sequential;
+        int num_threads = 1;
+        if (flag_is_registered_with_value("uct-parallel")) {
+            string parallel_str = flag_value("uct-parallel");
+            if (parallel_str == "root") {
+                parallel_mode = uct_root_parallel;
+            } else if (parallel_str == "tree") {
+                parallel_mode = uct_tree_parallel;
+            } else {
+                cerr << "Error: unknown UCT parallel mode." << endl;
+                exit(0);
+            }
+        }
+        if (flag_is_registered_with_value("threads"))
+            num_threads = stoi(flag_value("threads"));
         solver = new UCTSolver(problem,
                                rollouts, cutoff, C,
                                use_qvalues_for_c, delta,
-                               true);
+                               true, parallel_mode, num_threads);
+        if (flag_is_registered_with_value("virtual-loss")) {
+            static_cast<UCTSolver*>(solver)->virtualLoss(
+                stod(flag_value("virtual-loss")));
+        }
+        if (flag_is_registered("uct-root-policy"))
+            static_cast<UCTSolver*>(solver)->rootPolicy(true);
     } else if (algorithm != "greedy") {
         cerr << "Unknown algorithm: " << algorithm << endl;
         exit(-1);
@@ -482,8 +591,10 @@ vector<double> simulate(Solver* solver,
                 solver->maxPlanningTime(maxTime);
             }
             solver->reset();
-            if (!flag_is_registered("precompute-h"))
+            if (!flag_is_registered("precompute-h")) {
                 heuristic->reset();
+                problem->clearHeuristicCosts();
+            }
             startTime = clock();
             // Initial planning
             if (algorithm != "greedy")
@@ -531,7 +642,9 @@ vector<double> simulate(Solver* solver,
                 simulationPlanTime += planTime;
                 longestTime = std::max(longestTime, planTime);
                 numDecisions++;
-                if (algorithm != "hop")
+                if (algorithm != "hop" &&
+                        !(algorithm == "uct" &&
+                          flag_is_registered("uct-root-policy")))
                     a = greedyAction(problem, tmp);
             } else {
                 if (useUpperBound) {
@@ -644,9 +757,37 @@ int main(int argc, char* args[])
         mdplib_debug = true;
     if (flag_is_registered_with_value("dead-end-cost"))
         mdplib::dead_end_cost = stof(flag_value("dead-end-cost"));
+    if (flag_is_registered_with_value("seed"))
+        seedRNG(stoull(flag_value("seed")));
     setupProblem();
-    if (!flag_is_registered("dont-generate"))
+    if (flag_is_registered_with_value("gen-threads") ||
+            flag_is_registered_with_value("max-states") ||
+            flag_is_registered_with_value("max-memory")) {
+        GenerateOptions options;
+        if (flag_is_registered_with_value("gen-threads"))
+            options.numThreads = stoi(flag_value("gen-threads"));
+        if (flag_is_registered_with_value("max-states"))
+            options.maxStates = stol(flag_value("max-states"));
+        if (flag_is_registered_with_value("max-memory"))    // in MB
+            options.maxMemory = stol(flag_value("max-memory")) << 20;
+        if (verbosity > 100) {
+            options.progress = [] (const GenerateProgress& progress) {
+                cout << "level " << progress.levels
+                    << " states " << progress.numStates
+                    << " expanded " << progress.numExpanded
+                    << " frontier " << progress.frontierSize
+                    << " memory " << (progress.memoryUsage >> 20) << "MB"
+                    << endl;
+            };
+        }
+        bool complete = problem->generateAll(options);
+        if (verbosity > 100) {
+            cout << "Generated " << problem->numStates() << " states"
+                << (complete ? "" : " (stopped by the budget)") << endl;
+        }
+    } else if (!flag_is_registered("dont-generate")) {
         problem->generateAll();
+    }
     if (flag_is_registered_with_value("heuristic")) {
         if (flag_value("heuristic") == "hmin") {
             clock_t startTime = clock();
@@ -725,6 +866,7 @@ int main(int argc, char* args[])
         delete solver;
     }
 
+    delete compiledProblem;
     delete problem;
     delete heuristic;
 }